@@ -0,0 +1,185 @@
+#include "constexpr_math_batch.h"
+#include "fp_math_batch.h"
+#include "test_check.h"
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+// Every batch kernel at every simd_level the CPU supports, against the scalar kernels
+namespace {
+    using n4 = fp_math::number<4>;
+    using n2 = fp_math::number<2>;
+    using n6 = fp_math::number<6>;
+
+    // Sizes around the vector widths, so that every tail length is hit
+    constexpr size_t sizes[] = {0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 1001, 4099};
+
+    std::vector<simd_level> supported_levels(){
+        std::vector<simd_level> levels;
+        for (auto level: {simd_level::scalar, simd_level::sse4_2, simd_level::avx2})
+            if (level <= detect_simd_level())
+                levels.push_back(level);
+        return levels;
+    }
+
+    // Deterministic values in [-range, range), with repeats
+    std::vector<n4> make_values(size_t count, long long range){
+        std::vector<n4> values;
+        std::uint64_t state = 42;
+        for (size_t i = 0; i < count; ++i){
+            state = state * 6364136223846793005 + 1442695040888963407;
+            values.push_back(n4::from_raw(static_cast<long long>((state >> 33) % (2 * range)) - range));
+        }
+        return values;
+    }
+
+    // Thresholds equal to elements, between elements and beyond both ends
+    std::vector<n4> make_thresholds(std::span<const n4> values){
+        std::vector<n4> thresholds{
+            n4::from_raw(std::numeric_limits<long long>::min()), n4::from_raw(std::numeric_limits<long long>::max()), n4{0}};
+        for (size_t i = 0; i < values.size(); i += 1 + values.size() / 4){
+            thresholds.push_back(values[i]);
+            if (values[i].raw() != std::numeric_limits<long long>::max())
+                thresholds.push_back(values[i] + n4::from_raw(1));
+        }
+        return thresholds;
+    }
+
+    struct results {
+        n4 sum;
+        n4 min;
+        n4 max;
+        std::vector<std::vector<std::uint8_t>> masks;
+        std::vector<size_t> mask_counts;
+        std::vector<std::vector<n4>> copies;
+
+        bool operator==(const results&) const = default;
+    };
+
+    // Sums of values near the limits would overflow, so those skip the sum
+    results evaluate(std::span<const n4> values, std::span<const n4> thresholds, bool with_sum = true){
+        results r;
+        if (with_sum)
+            r.sum = fp_math::batch::sum(values);
+        if (!values.empty()){
+            r.min = fp_math::batch::min(values);
+            r.max = fp_math::batch::max(values);
+        }
+        for (const auto &threshold: thresholds){
+            std::vector<std::uint8_t> mask(values.size());
+            r.mask_counts.push_back(fp_math::batch::greater_mask(values, threshold, mask));
+            r.masks.push_back(std::move(mask));
+            r.copies.push_back(fp_math::batch::filter_greater(values, threshold));
+        }
+        return r;
+    }
+
+    void kernels_match_scalar(std::span<const n4> values, bool with_sum, const char *what){
+        const auto thresholds = make_thresholds(values);
+        set_simd_level(simd_level::scalar);
+        const auto expected = evaluate(values, thresholds, with_sum);
+        for (auto level: supported_levels()){
+            set_simd_level(level);
+            check(evaluate(values, thresholds, with_sum) == expected, what);
+        }
+    }
+
+    void fp_math_kernels(){
+        for (auto size: sizes){
+            // Offset by one element, so the vector loads are unaligned
+            const auto values = make_values(size + 1, 1'000'000);
+            kernels_match_scalar(std::span<const n4>{values}.subspan(1), true, "fp_math kernels match scalar");
+        }
+
+        // Compares must be signed 64-bit
+        for (auto size: sizes){
+            auto values = make_values(size, 3);
+            for (size_t i = 0; i < size; i += 3)
+                values[i] = n4::from_raw(i % 2 ? std::numeric_limits<long long>::min() : std::numeric_limits<long long>::max());
+            kernels_match_scalar(values, false, "fp_math kernels match scalar at the limits");
+        }
+
+        for (auto level: supported_levels()){
+            set_simd_level(level);
+            check(throws<std::runtime_error>([]{ fp_math::batch::min(std::vector<n4>{}); }), "min of empty range throws");
+        }
+    }
+
+    void rescale_matches_scalar(){
+        for (auto size: sizes){
+            const auto values = make_values(size, 1'000'000'000);
+            std::vector<n2> down(size);
+            std::vector<n6> up(size);
+            fp_math::batch::rescale<2>(values, down);
+            fp_math::batch::rescale<6>(values, up);
+            auto same = true;
+            for (size_t i = 0; i < size; ++i)
+                same = same && down[i] == fp_math::rescale<2>(values[i]) && up[i] == fp_math::rescale<6>(values[i]);
+            check(same, "rescale matches scalar");
+        }
+    }
+
+    // Angles the gather kernel has to clamp or hand back to the scalar reduction
+    std::vector<double> make_angles(size_t count){
+        const double special[] = {0.0, -0.0, -1e-17, 1e-17, 359.99999999, 360, -360, -720 + 1e-13,
+                                  1 << 30, -(1 << 30), 1e30, -1e30, INFINITY, -INFINITY, NAN};
+        std::vector<double> angles;
+        std::uint64_t state = 7;
+        for (size_t i = 0; i < count; ++i){
+            state = state * 6364136223846793005 + 1442695040888963407;
+            const auto uniform = static_cast<double>(state >> 11) / (1ull << 53);
+            angles.push_back(i % 5 == 4 ? special[(state >> 40) % std::size(special)] : uniform * 2000 - 1000);
+        }
+        return angles;
+    }
+
+    // Equal, or both NaN
+    bool same_value(double a, double b){
+        return a == b || (std::isnan(a) && std::isnan(b));
+    }
+
+    bool same_values(std::span<const double> a, std::span<const double> b){
+        for (size_t i = 0; i < a.size(); ++i)
+            if (!same_value(a[i], b[i]))
+                return false;
+        return true;
+    }
+
+    void trig_matches_scalar(){
+        static const constexpr_math::fast_trig<10, double> trig{};
+        for (auto size: sizes){
+            const auto angles = make_angles(size);
+            std::vector<double> expected_cos(size), expected_sin(size);
+            set_simd_level(simd_level::scalar);
+            constexpr_math::batch::cos(trig, angles, expected_cos);
+            constexpr_math::batch::sin(trig, angles, expected_sin);
+
+            auto same = true;
+            for (size_t i = 0; i < size; ++i)
+                same = same && same_value(expected_cos[i], trig.cos(angles[i])) && same_value(expected_sin[i], trig.sin(angles[i]));
+            check(same, "batch trig at scalar matches fast_trig");
+
+            for (auto level: supported_levels()){
+                set_simd_level(level);
+                std::vector<double> cos(size), sin(size);
+                constexpr_math::batch::cos(trig, angles, cos);
+                constexpr_math::batch::sin(trig, angles, sin);
+                check(same_values(cos, expected_cos), "batch cos matches scalar");
+                check(same_values(sin, expected_sin), "batch sin matches scalar");
+            }
+        }
+    }
+}
+
+int main(){
+    fp_math_kernels();
+    rescale_matches_scalar();
+    trig_matches_scalar();
+    set_simd_level(detect_simd_level());
+
+    return test_exit_code();
+}
@@ -0,0 +1,443 @@
+#include "constexpr_approx.h"
+#include "constexpr_math_batch.h"
+#include "cpu_features.h"
+#include "ctasks.h"
+#include "executor_resumer.h"
+#include "fp_math_batch.h"
+#include "tasks.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Baseline numbers for the scheduler and the numeric kernels.
+// Every benchmark prints one JSON object per line. Throughput benchmarks time
+// whole samples of many ops, so their percentiles are over sample means:
+//   {"benchmark": ..., "args": ..., "ns_per_op": median sample mean, "sample_mean_p90_ns": ..., "allocs_per_op": ...}
+// Latency benchmarks time every op, so their percentiles are over single ops:
+//   {"benchmark": ..., "args": ..., "ns_per_op": mean, "p50_ns": ..., "p99_ns": ..., "allocs_per_op": ...}
+// Usage: benchmarks [name filter]
+
+// Counts every allocation made through the global operator new
+static std::atomic<std::uint64_t> nof_allocations{0};
+
+void *operator new(size_t size){
+    nof_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (auto p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc{};
+}
+
+// Not inlined, or GCC warns that free() doesn't match operator new at the call sites
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void *p, size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+    using clock_type = std::chrono::steady_clock;
+
+    constexpr size_t nof_warmup_samples = 2;
+    // Enough that p99 isn't simply the slowest sample
+    constexpr size_t nof_samples = 100;
+    // Latency samples each record every op
+    constexpr size_t nof_latency_samples = 10;
+
+    std::string_view name_filter;
+
+    template<typename T>
+    void do_not_optimize(const T &value){
+        asm volatile("" : : "g"(&value) : "memory");
+    }
+
+    // Time and allocations of one sample. Benchmarks call start() after
+    // their untimed setup and stop() before their untimed teardown.
+    // Latency benchmarks also record() the end of every op.
+    class sample {
+        public:
+        // Reserves room for the latencies up front, so that recording doesn't allocate
+        explicit sample(size_t nof_latencies = 0){
+            latencies_.reserve(nof_latencies);
+        }
+
+        void start() noexcept {
+            allocations_ = nof_allocations.load(std::memory_order_relaxed);
+            start_ = clock_type::now();
+        }
+
+        void stop() noexcept {
+            elapsed_ = clock_type::now() - start_;
+            allocations_ = nof_allocations.load(std::memory_order_relaxed) - allocations_;
+        }
+
+        double nanoseconds() const noexcept {
+            return std::chrono::duration<double, std::nano>(elapsed_).count();
+        }
+
+        std::uint64_t allocations() const noexcept {
+            return allocations_;
+        }
+
+        // Ends one op that began at from
+        void record(clock_type::time_point from){
+            latencies_.push_back(std::chrono::duration<double, std::nano>(clock_type::now() - from).count());
+        }
+
+        const std::vector<double> &latencies() const noexcept {
+            return latencies_;
+        }
+
+        private:
+        clock_type::time_point start_;
+        clock_type::duration elapsed_{};
+        std::uint64_t allocations_ = 0;
+        std::vector<double> latencies_;
+    };
+
+    // Nearest rank
+    double percentile(const std::vector<double> &sorted, double p){
+        const auto rank = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+        return sorted[rank];
+    }
+
+    bool selected(std::string_view name){
+        return name.find(name_filter) != std::string_view::npos;
+    }
+
+    // fn(sample&, ops) performs ops operations, timing them with the sample
+    template<typename fn_t>
+    void run(std::string_view name, const std::string &args, size_t ops, fn_t &&fn){
+        if (!selected(name))
+            return;
+
+        for (size_t i = 0; i < nof_warmup_samples; ++i){
+            sample s;
+            fn(s, ops);
+        }
+
+        std::vector<double> ns_per_op;
+        std::uint64_t allocations = 0;
+        for (size_t i = 0; i < nof_samples; ++i){
+            sample s;
+            fn(s, ops);
+            ns_per_op.push_back(s.nanoseconds() / ops);
+            allocations += s.allocations();
+        }
+        std::sort(ns_per_op.begin(), ns_per_op.end());
+
+        std::printf("{\"benchmark\": \"%.*s\", \"args\": \"%s\", \"ops_per_sample\": %zu, \"samples\": %zu, "
+                    "\"ns_per_op\": %.2f, \"sample_mean_min_ns\": %.2f, \"sample_mean_p90_ns\": %.2f, "
+                    "\"sample_mean_p99_ns\": %.2f, \"allocs_per_op\": %.3f}\n",
+                    static_cast<int>(name.size()), name.data(), args.c_str(), ops, nof_samples,
+                    percentile(ns_per_op, 0.5), ns_per_op.front(),
+                    percentile(ns_per_op, 0.9), percentile(ns_per_op, 0.99),
+                    static_cast<double>(allocations) / (ops * nof_samples));
+        std::fflush(stdout);
+    }
+
+    // Like run(), but fn records every op, and percentiles are over single ops
+    template<typename fn_t>
+    void run_latency(std::string_view name, const std::string &args, size_t ops, fn_t &&fn){
+        if (!selected(name))
+            return;
+
+        for (size_t i = 0; i < nof_warmup_samples; ++i){
+            sample s{ops};
+            fn(s, ops);
+        }
+
+        std::vector<double> latencies;
+        std::uint64_t allocations = 0;
+        for (size_t i = 0; i < nof_latency_samples; ++i){
+            sample s{ops};
+            fn(s, ops);
+            latencies.insert(latencies.end(), s.latencies().begin(), s.latencies().end());
+            allocations += s.allocations();
+        }
+        if (latencies.size() != ops * nof_latency_samples)
+            throw std::runtime_error("Benchmark didn't record every op: " + std::string{name});
+        std::sort(latencies.begin(), latencies.end());
+        double total = 0;
+        for (auto l: latencies)
+            total += l;
+
+        std::printf("{\"benchmark\": \"%.*s\", \"args\": \"%s\", \"ops_per_sample\": %zu, \"samples\": %zu, "
+                    "\"ns_per_op\": %.2f, \"p50_ns\": %.2f, \"p90_ns\": %.2f, \"p99_ns\": %.2f, "
+                    "\"p999_ns\": %.2f, \"max_ns\": %.2f, \"allocs_per_op\": %.3f}\n",
+                    static_cast<int>(name.size()), name.data(), args.c_str(), ops, nof_latency_samples,
+                    total / latencies.size(), percentile(latencies, 0.5), percentile(latencies, 0.9),
+                    percentile(latencies, 0.99), percentile(latencies, 0.999), latencies.back(),
+                    static_cast<double>(allocations) / latencies.size());
+        std::fflush(stdout);
+    }
+
+    // Wraps a benchmark without setup, timing the whole call
+    template<typename fn_t>
+    auto timed(fn_t fn){
+        return [fn](sample &s, size_t ops) mutable {
+            s.start();
+            fn(ops);
+            s.stop();
+        };
+    }
+
+    std::vector<size_t> producer_counts(){
+        std::vector<size_t> counts;
+        const auto max_producers = std::max<size_t>(2, std::thread::hardware_concurrency());
+        for (size_t producers = 1; producers <= max_producers; producers *= 2)
+            counts.push_back(producers);
+        return counts;
+    }
+
+    // Runs fn(index) on nof_threads threads, started together once everything is set up
+    template<typename fn_t>
+    void run_concurrently(sample &s, size_t nof_threads, fn_t &&fn){
+        std::atomic<bool> go{false};
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < nof_threads; ++i)
+            threads.emplace_back([&go, &fn, i]{
+                while (!go.load(std::memory_order_acquire))
+                    std::this_thread::yield();
+                fn(i);
+            });
+
+        s.start();
+        go.store(true, std::memory_order_release);
+        for (auto &t: threads)
+            t.join();
+    }
+
+    struct counting_executable : public executable {
+        void execute() noexcept override {
+            count.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        std::atomic<size_t> count{0};
+    };
+
+    // schedule() from several threads at once, until every executable has run
+    void executor_schedule(){
+        executor ex{DEFAULT_CONCURRENCY};
+        for (auto producers: producer_counts()){
+            run("executor_schedule", "producers=" + std::to_string(producers), 1 << 14,
+                [&](sample &s, size_t ops){
+                    auto work = std::make_shared<counting_executable>();
+                    const auto per_producer = ops / producers;
+                    run_concurrently(s, producers, [&](size_t){
+                        for (size_t i = 0; i < per_producer; ++i)
+                            ex.schedule(work);
+                    });
+                    while (work->count.load(std::memory_order_relaxed) < per_producer * producers)
+                        std::this_thread::yield();
+                    s.stop();
+                });
+        }
+    }
+
+    ctask<int> ctask_return(int value){
+        co_return value;
+    }
+
+    // The sample is a parameter rather than a lambda capture, so the coroutine frame keeps it
+    ctask<int> ctask_await_loop(size_t ops, sample *s){
+        int total = 0;
+        for (size_t i = 0; i < ops; ++i){
+            const auto from = clock_type::now();
+            total += co_await ctask_return(1);
+            s->record(from);
+        }
+        co_return total;
+    }
+
+    // Create a ctask, run it on the executor and get its result
+    void ctask_latency(){
+        run_latency("ctask_await", "from=coroutine", 1 << 12, [](sample &s, size_t ops){
+            s.start();
+            do_not_optimize(ctask_await_loop(ops, &s).get());
+            s.stop();
+        });
+        run_latency("ctask_await", "from=thread", 1 << 12, [](sample &s, size_t ops){
+            s.start();
+            for (size_t i = 0; i < ops; ++i){
+                const auto from = clock_type::now();
+                do_not_optimize(ctask_return(1).get());
+                s.record(from);
+            }
+            s.stop();
+        });
+    }
+
+    // One op is a whole then() chain of the given depth, from creating the first
+    // task to getting the result of the last
+    void task_then_chain(){
+        executor ex{DEFAULT_CONCURRENCY};
+        for (size_t depth: {1, 16, 256}){
+            run_latency("task_then_chain", "depth=" + std::to_string(depth), std::max<size_t>(16, 4096 / depth),
+                [&ex, depth](sample &s, size_t ops){
+                    s.start();
+                    for (size_t chain = 0; chain < ops; ++chain){
+                        const auto from = clock_type::now();
+                        task_ptr<int> t = run_task(ex, []{ return 0; });
+                        for (size_t i = 0; i < depth; ++i)
+                            t = t->then([](int x){ return x + 1; });
+                        do_not_optimize(t->get_future().get());
+                        s.record(from);
+                    }
+                    s.stop();
+                });
+        }
+    }
+
+    template<size_t... i>
+    auto fork(const task_ptr<int> &root, std::index_sequence<i...>){
+        const auto fn = [](int x){ return x + 1; };
+        return root->then_fork(((void)i, fn)...);
+    }
+
+    // One op is a whole fork/join of the given width
+    template<size_t width>
+    void then_fork_width(executor &ex){
+        run_latency("task_then_fork", "width=" + std::to_string(width), 1 << 10,
+            [&ex](sample &s, size_t ops){
+                s.start();
+                for (size_t i = 0; i < ops; ++i){
+                    const auto from = clock_type::now();
+                    auto root = run_task(ex, []{ return 1; });
+                    do_not_optimize(fork(root, std::make_index_sequence<width>{})->get_future().get());
+                    s.record(from);
+                }
+                s.stop();
+            });
+    }
+
+    void task_then_fork(){
+        executor ex{DEFAULT_CONCURRENCY};
+        then_fork_width<1>(ex);
+        then_fork_width<2>(ex);
+        then_fork_width<4>(ex);
+        then_fork_width<8>(ex);
+    }
+
+    // Continuations added from several threads at once, then all resumed.
+    // One op is one add() plus its share of resume_all().
+    void executor_resumer_contention(){
+        for (auto producers: producer_counts()){
+            run("executor_resumer", "producers=" + std::to_string(producers), 1 << 14,
+                [producers](sample &s, size_t ops){
+                    // Drains the resumed handles when it goes out of scope, untimed
+                    executor ex{DEFAULT_CONCURRENCY};
+                    executor_resumer resumer;
+                    const auto per_producer = ops / producers;
+                    run_concurrently(s, producers, [&](size_t){
+                        for (size_t i = 0; i < per_producer; ++i)
+                            resumer.add(std::experimental::noop_coroutine(), &ex);
+                    });
+                    resumer.resume_all();
+                    s.stop();
+                });
+        }
+    }
+
+    constexpr const char *level_name(simd_level level){
+        switch (level){
+            case simd_level::scalar: return "scalar";
+            case simd_level::sse4_2: return "sse4_2";
+            case simd_level::avx2: return "avx2";
+        }
+        return "unknown";
+    }
+
+    // One op is one element
+    void kernels(){
+        constexpr size_t size = 4096;
+        constexpr size_t repeats = 64;
+        using number = fp_math::number<4>;
+
+        std::vector<number> prices;
+        std::vector<double> degrees;
+        for (size_t i = 0; i < size; ++i){
+            prices.emplace_back(100.0 + static_cast<double>(i % 97) / 7);
+            degrees.push_back(static_cast<double>(i) * 0.37 - 500);
+        }
+        std::vector<number> selected(size);
+        std::vector<double> cosines(size);
+        static const constexpr_math::fast_trig<10, double> trig{};
+        const auto threshold = number{105.0};
+
+        const auto detected = detect_simd_level();
+        for (auto level: {simd_level::scalar, simd_level::sse4_2, simd_level::avx2}){
+            if (level > detected)
+                break;
+            set_simd_level(level);
+            const auto args = std::string{"simd="} + level_name(level);
+
+            run("fp_math_sum", args, size * repeats, timed([&](size_t){
+                for (size_t r = 0; r < repeats; ++r)
+                    do_not_optimize(fp_math::batch::sum(prices));
+            }));
+            run("fp_math_dot", args, size * repeats, timed([&](size_t){
+                for (size_t r = 0; r < repeats; ++r)
+                    do_not_optimize(fp_math::batch::dot(prices, prices));
+            }));
+            run("fp_math_copy_greater", args, size * repeats, timed([&](size_t){
+                for (size_t r = 0; r < repeats; ++r)
+                    do_not_optimize(fp_math::batch::copy_greater(prices, threshold, selected));
+            }));
+            run("fast_trig_cos", args, size * repeats, timed([&](size_t){
+                for (size_t r = 0; r < repeats; ++r){
+                    constexpr_math::batch::cos(trig, degrees, cosines);
+                    do_not_optimize(cosines);
+                }
+            }));
+        }
+        set_simd_level(detected);
+
+        run("fast_trig_cos", "scalar_loop", size * repeats, timed([&](size_t){
+            for (size_t r = 0; r < repeats; ++r)
+                for (size_t i = 0; i < size; ++i)
+                    do_not_optimize(trig.cos(degrees[i]));
+        }));
+        // Explicit degrees, so the rows measure the polynomial whatever the default does at run time
+        run("approx_cos", "degree=6", size * repeats, timed([&](size_t){
+            for (size_t r = 0; r < repeats; ++r)
+                for (size_t i = 0; i < size; ++i)
+                    do_not_optimize(constexpr_math::approx::cos<6>(degrees[i] * constexpr_math::pi / 180));
+        }));
+        run("approx_cos", "degree=4", size * repeats, timed([&](size_t){
+            for (size_t r = 0; r < repeats; ++r)
+                for (size_t i = 0; i < size; ++i)
+                    do_not_optimize(constexpr_math::approx::cos<4>(degrees[i] * constexpr_math::pi / 180));
+        }));
+        run("std_cos", "scalar_loop", size * repeats, timed([&](size_t){
+            for (size_t r = 0; r < repeats; ++r)
+                for (size_t i = 0; i < size; ++i)
+                    do_not_optimize(std::cos(degrees[i] * constexpr_math::pi / 180));
+        }));
+    }
+}
+
+int main(int argc, char *argv[]){
+    if (argc > 1)
+        name_filter = argv[1];
+
+    executor_schedule();
+    ctask_latency();
+    task_then_chain();
+    task_then_fork();
+    executor_resumer_contention();
+    kernels();
+    return 0;
+}
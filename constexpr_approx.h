@@ -0,0 +1,448 @@
+#pragma once
+
+#include "constexpr_math.h"
+
+#include <bit>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace constexpr_math {
+    // c[0] + c[1] x + c[2] x^2 + ...
+    template<size_t degree_v, typename number_t>
+    struct polynomial {
+        static constexpr auto degree = degree_v;
+
+        number_t coefficients[degree_v + 1] = {};
+
+        // Horner's scheme: one multiply-add per coefficient
+        constexpr number_t operator()(const number_t &x) const {
+            auto result = coefficients[degree_v];
+            for (auto i = degree_v; i-- > 0;)
+                result = result * x + coefficients[i];
+            return result;
+        }
+    };
+
+    // Polynomial approximation on [from, to],
+    // evaluated in the normalised variable t = x * scale + shift, t in [-1, 1]
+    template<size_t degree_v, typename number_t>
+    struct chebyshev_approximation {
+        polynomial<degree_v, number_t> poly;
+        number_t scale;
+        number_t shift;
+
+        constexpr number_t operator()(const number_t &x) const {
+            return poly(x * scale + shift);
+        }
+    };
+
+    // Interpolates fn at the Chebyshev nodes of [from, to], which is within
+    // a small factor of the minimax polynomial of the same degree.
+    // Coefficients are computed in long double and then rounded to number_t.
+    // Higher degrees reduce the error, but conversion to power form gets
+    // ill-conditioned, so keep intervals small and degrees below ~20.
+    template<size_t degree_v, typename number_t, typename fn_t>
+    constexpr auto chebyshev_fit(const fn_t &fn, long double from, long double to){
+        using fit_t = long double;
+        constexpr auto n = degree_v + 1;
+
+        // Chebyshev series coefficients. T_j(node) comes from the recurrence
+        // T_j+1 = 2 x T_j - T_j-1, so cos is only needed for the nodes themselves.
+        fit_t c[n] = {};
+        for (size_t k = 0; k < n; ++k){
+            const auto node = constexpr_math::cos(fit_t{pi} * (k + fit_t{0.5}) / n);
+            const auto y = fn((node * (to - from) + from + to) / 2);
+            fit_t t_prev = 0;
+            fit_t t_cur = 1;
+            for (size_t j = 0; j < n; ++j){
+                c[j] += y * t_cur;
+                const auto t_next = (j == 0 ? 1 : 2) * node * t_cur - t_prev;
+                t_prev = t_cur;
+                t_cur = t_next;
+            }
+        }
+        for (auto &coefficient: c)
+            coefficient *= fit_t{2} / n;
+        c[0] /= 2;
+
+        // Power form of sum(c_j T_j), same recurrence on coefficient arrays
+        fit_t power[n] = {};
+        fit_t t_prev[n] = {};
+        fit_t t_cur[n] = {1};
+        for (size_t j = 0; j < n; ++j){
+            fit_t t_next[n] = {};
+            for (size_t i = 0; i < n; ++i){
+                power[i] += c[j] * t_cur[i];
+                if (i + 1 < n)
+                    t_next[i + 1] += (j == 0 ? 1 : 2) * t_cur[i];
+                t_next[i] -= t_prev[i];
+            }
+            for (size_t i = 0; i < n; ++i){
+                t_prev[i] = t_cur[i];
+                t_cur[i] = t_next[i];
+            }
+        }
+
+        chebyshev_approximation<degree_v, number_t> result{};
+        for (size_t i = 0; i < n; ++i)
+            result.poly.coefficients[i] = static_cast<number_t>(power[i]);
+        result.scale = static_cast<number_t>(2 / (to - from));
+        result.shift = static_cast<number_t>(-(from + to) / (to - from));
+        return result;
+    }
+
+    // Largest |approx(x) - exact(x)| / max(|exact(x)|, 1) over evenly spaced samples
+    template<typename approx_fn_t, typename exact_fn_t>
+    constexpr long double max_error(const approx_fn_t &approx, const exact_fn_t &exact,
+                                    long double from, long double to, size_t nof_samples = 100){
+        long double error = 0;
+        for (size_t i = 0; i <= nof_samples; ++i){
+            const auto x = from + (to - from) * i / nof_samples;
+            const auto expected = exact(x);
+            const auto scale = abs(expected) > 1 ? abs(expected) : 1;
+            const auto e = abs(approx(x) - expected) / scale;
+            error = e > error ? e : error;
+        }
+        return error;
+    }
+
+    static_assert(max_error(chebyshev_fit<2, double>([](long double x){ return x * x - 3 * x; }, -5, 7),
+                            [](long double x){ return x * x - 3 * x; }, -5, 7) < 1e-12);
+
+    // Slow, accurate series used to generate the approximations.
+    // Only accurate for the small arguments they are sampled at.
+    namespace reference {
+        constexpr long double sin(long double x){
+            long double sum = x;
+            long double t = x;
+            for (auto i = 1; i <= 20; ++i){
+                t *= -x * x / (2 * i * (2 * i + 1));
+                sum += t;
+            }
+            return sum;
+        }
+
+        // cos(sqrt(z)) = sum (-z)^k / (2k)!
+        constexpr long double cos_sqrt(long double z){
+            long double sum = 0;
+            long double t = 1;
+            for (auto k = 0; k <= 20; ++k){
+                sum += t;
+                t *= -z / ((2 * k + 1) * (2 * k + 2));
+            }
+            return sum;
+        }
+
+        // sin(sqrt(z)) / sqrt(z) = sum (-z)^k / (2k + 1)!
+        constexpr long double sin_ratio(long double z){
+            long double sum = 0;
+            long double t = 1;
+            for (auto k = 0; k <= 20; ++k){
+                sum += t;
+                t *= -z / ((2 * k + 2) * (2 * k + 3));
+            }
+            return sum;
+        }
+
+        constexpr long double exp(long double x){
+            long double sum = 1;
+            long double t = 1;
+            for (auto i = 1; i <= 30; ++i){
+                t *= x / i;
+                sum += t;
+            }
+            return sum;
+        }
+
+        // atanh(sqrt(z)) / sqrt(z) = sum z^k / (2k + 1)
+        constexpr long double atanh_ratio(long double z){
+            long double sum = 0;
+            long double t = 1;
+            for (auto k = 0; k <= 30; ++k){
+                sum += t / (2 * k + 1);
+                t *= z;
+            }
+            return sum;
+        }
+
+        constexpr long double rsqrt(long double x){
+            long double y = 1;
+            for (auto i = 0; i < 10; ++i)
+                y *= (3 - x * y * y) / 2;
+            return y;
+        }
+    }
+
+    // Polynomial approximations usable both at compile time and at run time.
+    // The default degree 0 means as accurate as double allows.
+    // cos and sin evaluate their polynomials at run time too, which beats the standard
+    // library. sqrt (a single instruction), exp and log use the standard library at
+    // run time, because it is faster there; an explicit degree forces the polynomial.
+    namespace approx {
+        namespace detail {
+            // Cody-Waite constants: the high parts have trailing zero bits,
+            // so k * hi is exact for the k we get from reasonable arguments
+            constexpr double pio2_hi = 1.57079632673412561417e+00;
+            constexpr double pio2_lo = 6.07710050650619224932e-11;
+            constexpr double ln2_hi = 6.93147180369123816490e-01;
+            constexpr double ln2_lo = 1.90821492927058770002e-10;
+            constexpr long double inverse_ln2 = 1.44269504088896340736L;
+            constexpr long double sqrt2 = 1.41421356237309504880L;
+
+            // Lowest degrees at which the error is down to rounding
+            constexpr size_t cos_degree = 6;
+            constexpr size_t exp_degree = 10;
+            constexpr size_t log_degree = 6;
+            constexpr size_t rsqrt_degree = 5;
+
+            // k * pio2_hi is exact up to here, see reduce_half_pi
+            constexpr double max_reducible = 1e6;
+
+            // Only for |x| well inside the range of long long
+            template<typename number_t>
+            constexpr long long round_to_int(const number_t &x){
+                return static_cast<long long>(x < 0 ? x - number_t{0.5} : x + number_t{0.5});
+            }
+
+            // cos and sin are even and odd, so they are fitted in r^2 over r in [-pi/4, pi/4]:
+            // cos(r) = cos_poly(r^2), sin(r) = r sin_poly(r^2)
+            template<size_t degree_v, typename number_t>
+            inline constexpr auto cos_poly = chebyshev_fit<degree_v, number_t>(
+                [](long double z){ return reference::cos_sqrt(z); }, 0, pi * pi / 16);
+
+            template<size_t degree_v, typename number_t>
+            inline constexpr auto sin_poly = chebyshev_fit<degree_v, number_t>(
+                [](long double z){ return reference::sin_ratio(z); }, 0, pi * pi / 16);
+
+            template<size_t degree_v, typename number_t>
+            inline constexpr auto exp_poly = chebyshev_fit<degree_v, number_t>(
+                [](long double x){ return reference::exp(x); }, -ln2_hi / 2, ln2_hi / 2);
+
+            // log(m) = 2 s atanh_ratio(s^2), s = (m - 1) / (m + 1), m in [sqrt(1/2), sqrt(2)]
+            constexpr long double max_s = (sqrt2 - 1) / (sqrt2 + 1);
+            template<size_t degree_v, typename number_t>
+            inline constexpr auto log_poly = chebyshev_fit<degree_v, number_t>(
+                [](long double z){ return reference::atanh_ratio(z); }, 0, max_s * max_s);
+
+            // Only a starting point for Newton iterations
+            template<size_t degree_v, typename number_t>
+            inline constexpr auto rsqrt_poly = chebyshev_fit<degree_v, number_t>(
+                [](long double x){ return reference::rsqrt(x); }, 0.5, 2);
+
+            template<std::floating_point number_t>
+            constexpr bool has_exponent_bits = std::numeric_limits<number_t>::is_iec559 &&
+                (sizeof(number_t) == sizeof(std::uint64_t) || sizeof(number_t) == sizeof(std::uint32_t));
+
+            template<std::floating_point number_t>
+            constexpr bool is_normal_exponent(int k){
+                using limits = std::numeric_limits<number_t>;
+                return k >= limits::min_exponent - 1 && k < limits::max_exponent;
+            }
+
+            // 2^k straight from the exponent bits, k must be a normal exponent
+            template<std::floating_point number_t>
+            requires has_exponent_bits<number_t>
+            constexpr number_t pow2_normal(int k){
+                using limits = std::numeric_limits<number_t>;
+                using bits_t = std::conditional_t<sizeof(number_t) == sizeof(std::uint64_t), std::uint64_t, std::uint32_t>;
+                return std::bit_cast<number_t>(static_cast<bits_t>(k + limits::max_exponent - 1) << (limits::digits - 1));
+            }
+
+            template<std::floating_point number_t>
+            constexpr number_t pow2(int k){
+                if constexpr (has_exponent_bits<number_t>){
+                    if (is_normal_exponent<number_t>(k))
+                        return pow2_normal<number_t>(k);
+                }
+                number_t result = 1;
+                number_t base = k < 0 ? number_t{0.5} : number_t{2};
+                for (auto n = k < 0 ? -k : k; n != 0; n >>= 1){
+                    if (n & 1)
+                        result *= base;
+                    base *= base;
+                }
+                return result;
+            }
+
+            // One multiplication while 2^k is normal. Near the ends of the exponent range
+            // two steps, so that results there don't overflow or flush to zero early.
+            template<std::floating_point number_t>
+            constexpr number_t ldexp(const number_t &value, int k){
+                if constexpr (has_exponent_bits<number_t>){
+                    if (is_normal_exponent<number_t>(k)) [[likely]]
+                        return value * pow2_normal<number_t>(k);
+                }
+                return value * pow2<number_t>(k / 2) * pow2<number_t>(k - k / 2);
+            }
+
+            // Splits a positive, finite x into m * 2^e, m in [0.5, 1)
+            template<std::floating_point number_t>
+            constexpr std::pair<number_t, int> frexp(number_t x){
+                using limits = std::numeric_limits<number_t>;
+                auto e = 0;
+                if (x < limits::min()){
+                    x *= pow2<number_t>(limits::digits);
+                    e -= limits::digits;
+                }
+                if constexpr (limits::is_iec559 && sizeof(number_t) == sizeof(std::uint64_t)){
+                    constexpr auto shift = limits::digits - 1;
+                    constexpr auto bias = limits::max_exponent - 2;
+                    const auto bits = std::bit_cast<std::uint64_t>(x);
+                    const auto exponent_mask = std::uint64_t{0x7ff} << shift;
+                    e += static_cast<int>((bits & exponent_mask) >> shift) - bias;
+                    return {std::bit_cast<number_t>((bits & ~exponent_mask) | (static_cast<std::uint64_t>(bias) << shift)), e};
+                }
+                else if constexpr (limits::is_iec559 && sizeof(number_t) == sizeof(std::uint32_t)){
+                    constexpr auto shift = limits::digits - 1;
+                    constexpr auto bias = limits::max_exponent - 2;
+                    const auto bits = std::bit_cast<std::uint32_t>(x);
+                    const auto exponent_mask = std::uint32_t{0xff} << shift;
+                    e += static_cast<int>((bits & exponent_mask) >> shift) - bias;
+                    return {std::bit_cast<number_t>((bits & ~exponent_mask) | (static_cast<std::uint32_t>(bias) << shift)), e};
+                }
+                else {
+                    for (; x >= 1; x /= 2)
+                        ++e;
+                    for (; x < number_t{0.5}; x *= 2)
+                        --e;
+                    return {x, e};
+                }
+            }
+        }
+
+        namespace detail {
+            // x = k pi/2 + r, r in [-pi/4, pi/4]. Only called with |x| < max_reducible,
+            // or at compile time, where larger arguments can't be reduced exactly.
+            template<std::floating_point number_t>
+            constexpr std::pair<number_t, long long> reduce_half_pi(const number_t &x){
+                if (!(abs(x) <= std::numeric_limits<number_t>::max()))
+                    return {std::numeric_limits<number_t>::quiet_NaN(), 0};
+                if (!(abs(x) < number_t{max_reducible}))
+                    throw std::runtime_error("Argument too large to reduce at compile time");
+                const auto k = round_to_int(x * number_t{2 / pi});
+                return {x - k * number_t{pio2_hi} - k * number_t{pio2_lo}, k};
+            }
+
+            // sin for quadrant 0, cos for quadrant 1 and so on
+            template<size_t degree_v, std::floating_point number_t>
+            constexpr number_t sin_quadrant(const number_t &r, long long quadrant){
+                const auto z = r * r;
+                switch (quadrant & 3){
+                    case 0: return r * sin_poly<degree_v, number_t>(z);
+                    case 1: return cos_poly<degree_v, number_t>(z);
+                    case 2: return -r * sin_poly<degree_v, number_t>(z);
+                    default: return -cos_poly<degree_v, number_t>(z);
+                }
+            }
+        }
+
+        // Degrees are in r^2. Infinite and NaN arguments give NaN. At run time, arguments
+        // from max_reducible on, where reduction stops being exact, go to the standard library.
+        template<size_t degree_v = 0, std::floating_point number_t>
+        constexpr number_t cos(const number_t &x){
+            if (!std::is_constant_evaluated() && !(abs(x) < number_t{detail::max_reducible}))
+                return std::cos(x);
+            const auto [r, k] = detail::reduce_half_pi(x);
+            return detail::sin_quadrant<degree_v == 0 ? detail::cos_degree : degree_v>(r, k + 1);
+        }
+
+        template<size_t degree_v = 0, std::floating_point number_t>
+        constexpr number_t sin(const number_t &x){
+            if (!std::is_constant_evaluated() && !(abs(x) < number_t{detail::max_reducible}))
+                return std::sin(x);
+            const auto [r, k] = detail::reduce_half_pi(x);
+            return detail::sin_quadrant<degree_v == 0 ? detail::cos_degree : degree_v>(r, k);
+        }
+
+        // exp(x) = 2^k exp(r), r in [-ln2/2, ln2/2]
+        template<size_t degree_v = 0, std::floating_point number_t>
+        constexpr number_t exp(const number_t &x){
+            if (degree_v == 0 && !std::is_constant_evaluated())
+                return std::exp(x);
+            constexpr auto degree = degree_v == 0 ? detail::exp_degree : degree_v;
+            using limits = std::numeric_limits<number_t>;
+            if (x != x)
+                return x;
+            if (x > number_t{limits::max_exponent * detail::ln2_hi})
+                return limits::infinity();
+            if (x < number_t{(limits::min_exponent - limits::digits) * detail::ln2_hi})
+                return 0;
+            const auto k = detail::round_to_int(x * number_t{detail::inverse_ln2});
+            const auto r = x - k * number_t{detail::ln2_hi} - k * number_t{detail::ln2_lo};
+            return detail::ldexp(detail::exp_poly<degree, number_t>(r), static_cast<int>(k));
+        }
+
+        // log(x) = e ln2 + log(m), m in [sqrt(1/2), sqrt(2)]
+        template<size_t degree_v = 0, std::floating_point number_t>
+        constexpr number_t log(const number_t &x){
+            if (degree_v == 0 && !std::is_constant_evaluated())
+                return std::log(x);
+            constexpr auto degree = degree_v == 0 ? detail::log_degree : degree_v;
+            using limits = std::numeric_limits<number_t>;
+            if (x != x || x == limits::infinity())
+                return x;
+            if (x < 0)
+                return limits::quiet_NaN();
+            if (x == 0)
+                return -limits::infinity();
+            auto [m, e] = detail::frexp(x);
+            if (m < number_t{1 / detail::sqrt2}){
+                m *= 2;
+                --e;
+            }
+            const auto s = (m - 1) / (m + 1);
+            const auto log_m = 2 * s * detail::log_poly<degree, number_t>(s * s);
+            return e * number_t{detail::ln2_hi} + (log_m + e * number_t{detail::ln2_lo});
+        }
+
+        // Polynomial estimate of 1/sqrt(m), m in [0.5, 2), refined with
+        // division-free Newton steps, then one correction of sqrt(m) = m / sqrt(m)
+        template<size_t degree_v = 0, std::floating_point number_t>
+        constexpr number_t sqrt(const number_t &x){
+            if (degree_v == 0 && !std::is_constant_evaluated())
+                return std::sqrt(x);
+            constexpr auto degree = degree_v == 0 ? detail::rsqrt_degree : degree_v;
+            using limits = std::numeric_limits<number_t>;
+            if (x != x || x == 0 || x == limits::infinity())
+                return x;
+            if (x < 0)
+                return limits::quiet_NaN();
+            auto [m, e] = detail::frexp(x);
+            if (e % 2 != 0){
+                m *= 2;
+                --e;
+            }
+            auto y = detail::rsqrt_poly<degree, number_t>(m);
+            for (auto i = 0; i < 3; ++i)
+                y *= number_t{1.5} - number_t{0.5} * m * y * y;
+            auto s = m * y;
+            s += number_t{0.5} * y * (m - s * s);
+            return detail::ldexp(s, e / 2);
+        }
+
+        static_assert(max_error([](long double x){ return cos(static_cast<double>(x)); },
+                                [](long double x){ return constexpr_math::cos(x); }, -3, 3) < 1e-15);
+        static_assert(max_error([](long double x){ return sin(static_cast<double>(x)); },
+                                [](long double x){ return reference::sin(x); }, -3, 3) < 1e-15);
+        static_assert(max_error([](long double x){ return exp(static_cast<double>(x)); },
+                                [](long double x){ return reference::exp(x); }, -2, 2) < 1e-15);
+        static_assert(max_error([](long double x){ return log(static_cast<double>(exp(x))); },
+                                [](long double x){ return x; }, -30, 30) < 1e-15);
+        static_assert(max_error([](long double x){ return sqrt(static_cast<double>(x * x)); },
+                                [](long double x){ return x; }, 0, 1000) < 1e-15);
+
+        static_assert(equal(cos(rad(60.0)), 0.5));
+        static_assert(equal(sin(-1000.0), -0.8268795405320025));
+        static_assert(equal(sqrt(2.0f), 1.4142135f));
+        static_assert(equal(cos<3>(1.0), 0.5403023058681398));
+        static_assert(cos(-std::numeric_limits<double>::infinity()) != cos(-std::numeric_limits<double>::infinity()));
+        static_assert(equal(cos(1e5), -0.9993608074382124));
+        static_assert(exp(-700.0) > 0 && exp(-740.0) > 0 && exp(-746.0) == 0);
+        static_assert(exp(709.0) < std::numeric_limits<double>::infinity() && exp(710.0) == std::numeric_limits<double>::infinity());
+    }
+}
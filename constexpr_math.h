@@ -1,8 +1,12 @@
 #pragma once
 
+#include <cmath>
+#include <concepts>
 #include <cstdlib> // for size_t
+#include <limits>
 #include <stdexcept>
 #include <type_traits>
+#include <utility>
 
 namespace constexpr_math {
     template<typename T>
@@ -79,7 +83,7 @@ namespace constexpr_math {
         }
 
         constexpr number_t value_at(unsigned table_index) const {
-            if (table_index / precision > 360)
+            if (table_index >= nof_values)
                 throw std::runtime_error ("Angle must be under 360 degrees");
             
             return cos_table[table_index];
@@ -93,24 +97,260 @@ namespace constexpr_math {
 
     static_assert(equal(fast_cos<10, double>{}.cos(60), 0.5));
 
+    template<std::floating_point number_t>
+    constexpr number_t floor(const number_t &value){
+        // Values this large have no fraction, and wouldn't fit in long long. Also covers NaN.
+        constexpr auto integral_from = static_cast<number_t>(1ull << (std::numeric_limits<number_t>::digits - 1));
+        if (!(abs(value) < integral_from))
+            return value;
+        const auto truncated = static_cast<number_t>(static_cast<long long>(value));
+        return truncated > value ? truncated - 1 : truncated;
+    }
+
+    static_assert(floor(-0.5) == -1.0 && floor(2.5) == 2.0 && floor(-3.0) == -3.0);
+    static_assert(floor(1e30) == 1e30 && floor(-1e300) == -1e300);
+
+    // Exact remainder of value / divisor, with the sign of value, like std::fmod
+    template<std::floating_point number_t>
+    constexpr number_t fmod(const number_t &value, const number_t &divisor){
+        if (!std::is_constant_evaluated())
+            return std::fmod(value, divisor);
+        if (!(abs(value) <= std::numeric_limits<number_t>::max()) || !(abs(divisor) > 0))
+            return std::numeric_limits<number_t>::quiet_NaN();
+
+        // Subtract the largest divisor * 2^k that fits; each subtraction is exact
+        const auto d = abs(divisor);
+        auto remainder = abs(value);
+        while (remainder >= d){
+            auto multiple = d;
+            while (multiple <= remainder / 2)
+                multiple *= 2;
+            remainder -= multiple;
+        }
+        return value < 0 ? -remainder : remainder;
+    }
+
+    static_assert(fmod(725.0, 360.0) == 5.0 && fmod(-725.0, 360.0) == -5.0);
+    static_assert(fmod(1e30, 360.0) == 16.0);
+
+    enum class interpolation { nearest, linear, cubic };
+
+    // Table-based cos and sin for any angle, in degrees or radians.
+    // Values between table entries are interpolated.
+    template<unsigned short precision_v, typename number_t, interpolation interpolation_v = interpolation::linear>
+    class fast_trig{
+        public:
+        static constexpr auto precision = precision_v;
+        static constexpr auto nof_values = precision * 360;
+
+        constexpr fast_trig() : table_() {
+            // One extra entry before and two after the full circle, so that
+            // interpolation never needs to wrap the index
+            for (auto i = size_t{0}; i < nof_values + padding; ++i){
+                auto deg = (static_cast<number_t>(i) - 1) / precision;
+                // Keep Taylor series arguments in [0, 180] degrees, where they are accurate
+                deg = deg < 0 ? -deg : deg;
+                deg = deg > 180 ? 360 - deg : deg;
+                table_[i] = constexpr_math::cos(rad(deg));
+            }
+        }
+
+        // Angles at least this large are reduced exactly, which is slower
+        static constexpr auto exact_reduction_from = number_t{1 << 30};
+
+        // Maps any finite angle to [0, 360)
+        static constexpr number_t reduce(const number_t &deg) {
+            auto reduced = abs(deg) < exact_reduction_from ? deg - floor(deg / 360) * 360
+                                                           : fmod(deg, number_t{360});
+            // Rounding can land just outside, e.g. -1e-17 gives exactly 360
+            if (reduced < 0)
+                reduced += 360;
+            return reduced < 360 ? reduced : reduced - 360;
+        }
+
+        // NaN for infinite and NaN angles, like std::cos
+        constexpr number_t cos(const number_t &deg) const {
+            if (!(abs(deg) <= std::numeric_limits<number_t>::max()))
+                return std::numeric_limits<number_t>::quiet_NaN();
+            const auto x = reduce(deg) * precision;
+            // The multiplication can still round up to nof_values
+            const auto index = x < nof_values - 1 ? floor(x) : number_t{nof_values - 1};
+            return lookup(static_cast<int>(index), x - index);
+        }
+
+        // Reduced first: for large angles deg - 90 would round back to deg
+        constexpr number_t sin(const number_t &deg) const {
+            return cos(reduce(deg) - 90);
+        }
+
+        constexpr number_t cos_rad(const number_t &rad) const {
+            return cos(rad * deg_per_rad);
+        }
+
+        constexpr number_t sin_rad(const number_t &rad) const {
+            return sin(rad * deg_per_rad);
+        }
+
+        // Table entry for index i is at data()[i], valid for i in [-1, nof_values + 1]
+        constexpr const number_t *data() const {
+            return table_ + 1;
+        }
+
+        private:
+        static constexpr auto padding = 3;
+        static constexpr auto deg_per_rad = number_t{180} / number_t{pi};
+
+        constexpr number_t lookup(int index, const number_t &t) const {
+            const auto p = data() + index;
+            if constexpr (interpolation_v == interpolation::nearest){
+                return t < number_t{0.5} ? p[0] : p[1];
+            }
+            else if constexpr (interpolation_v == interpolation::linear){
+                return p[0] + (p[1] - p[0]) * t;
+            }
+            else {
+                // Catmull-Rom spline through the 4 nearest entries
+                const auto a = -p[-1] + 3 * p[0] - 3 * p[1] + p[2];
+                const auto b = 2 * p[-1] - 5 * p[0] + 4 * p[1] - p[2];
+                const auto c = -p[-1] + p[1];
+                return p[0] + t * (c + t * (b + t * a)) / 2;
+            }
+        }
+
+        number_t table_[nof_values + padding];
+    };
+
+    // Small tables: building them at compile time isn't free
+    static_assert(equal(fast_trig<1, double>{}.cos(-300), 0.5));
+    static_assert(equal(fast_trig<1, double>{}.sin(750), 0.5));
+    static_assert(equal(fast_trig<1, double>{}.cos(359.99), 1.0));
+    static_assert(equal(fast_trig<1, double>{}.cos_rad(pi / 3), 0.5));
+    static_assert(equal(fast_trig<1, double, interpolation::linear>{}.cos(60.5), cos(rad(60.5))));
+    static_assert(equal(fast_trig<1, double, interpolation::cubic>{}.sin(-30.25), -cos(rad(59.75))));
+    static_assert(fast_trig<1, double, interpolation::nearest>{}.cos(59.6) == cos(rad(60.0)));
+    // Angles that reduce to exactly 360, or just below 0, before folding
+    static_assert(fast_trig<1, double, interpolation::cubic>{}.cos(-1e-17) == 1.0);
+    static_assert(fast_trig<1, double, interpolation::cubic>{}.cos(-0.0) == 1.0);
+    static_assert(equal(fast_trig<1, double, interpolation::cubic>{}.cos(720 - 1e-13), 1.0));
+    static_assert(equal(fast_trig<1, double>{}.cos(1e30), cos(rad(16.0))));
+    static_assert(equal(fast_trig<1, double>{}.sin(1e30), cos(rad(74.0))));
+    static_assert(fast_trig<1, double>{}.cos(std::numeric_limits<double>::infinity()) !=
+                  fast_trig<1, double>{}.cos(std::numeric_limits<double>::infinity()));
+
     template<typename number_t>
     struct complex {
+        using value_type = number_t;
+
         complex() = default;
 
         template<typename r_t, typename i_t>
         constexpr complex(r_t &&r, i_t &&i)
-            : real{std::forward<number_t>(r)}, imag{std::forward<number_t>(i)}
+            : real(std::forward<r_t>(r)), imag(std::forward<i_t>(i))
             {}
 
         number_t real;
         number_t imag;
+
+        constexpr complex &operator +=(const complex &rhs){
+            real += rhs.real;
+            imag += rhs.imag;
+            return *this;
+        }
+
+        constexpr complex &operator -=(const complex &rhs){
+            real -= rhs.real;
+            imag -= rhs.imag;
+            return *this;
+        }
+
+        constexpr complex &operator *=(const complex &rhs){
+            return *this = *this * rhs;
+        }
+
+        constexpr complex &operator /=(const complex &rhs){
+            return *this = *this / rhs;
+        }
+
+        constexpr complex &operator *=(const number_t &rhs){
+            real *= rhs;
+            imag *= rhs;
+            return *this;
+        }
+
+        constexpr complex &operator /=(const number_t &rhs){
+            real /= rhs;
+            imag /= rhs;
+            return *this;
+        }
+
+        constexpr complex operator -() const {
+            return {-real, -imag};
+        }
+
+        friend constexpr complex operator +(complex lhs, const complex &rhs){
+            return lhs += rhs;
+        }
+
+        friend constexpr complex operator -(complex lhs, const complex &rhs){
+            return lhs -= rhs;
+        }
+
+        friend constexpr complex operator *(const complex &lhs, const complex &rhs){
+            return {lhs.real * rhs.real - lhs.imag * rhs.imag,
+                    lhs.real * rhs.imag + lhs.imag * rhs.real};
+        }
+
+        friend constexpr complex operator /(const complex &lhs, const complex &rhs){
+            const auto divisor = rhs.real * rhs.real + rhs.imag * rhs.imag;
+            return {(lhs.real * rhs.real + lhs.imag * rhs.imag) / divisor,
+                    (lhs.imag * rhs.real - lhs.real * rhs.imag) / divisor};
+        }
+
+        friend constexpr complex operator *(complex lhs, const number_t &rhs){
+            return lhs *= rhs;
+        }
+
+        friend constexpr complex operator *(const number_t &lhs, complex rhs){
+            return rhs *= lhs;
+        }
+
+        friend constexpr complex operator /(complex lhs, const number_t &rhs){
+            return lhs /= rhs;
+        }
+
+        friend constexpr bool operator ==(const complex &lhs, const complex &rhs){
+            return lhs.real == rhs.real && lhs.imag == rhs.imag;
+        }
     };
 
     static_assert(complex<int>{0, 0}.real == 0);
 
+    template<typename number_t>
+    constexpr complex<number_t> conj(const complex<number_t> &value){
+        return {value.real, -value.imag};
+    }
+
+    // Squared magnitude
+    template<typename number_t>
+    constexpr number_t norm(const complex<number_t> &value){
+        return value.real * value.real + value.imag * value.imag;
+    }
+
+    template<typename number_t>
+    constexpr bool equal(const complex<number_t> &a, const complex<number_t> &b){
+        return equal(a.real, b.real) && equal(a.imag, b.imag);
+    }
+
+    static_assert(complex<int>{1, 2} * complex<int>{3, -1} == complex<int>{5, 5});
+    static_assert(complex<double>{5, 5} / complex<double>{3, -1} == complex<double>{1, 2});
+    static_assert(complex<int>{1, 2} + complex<int>{3, -1} - complex<int>{4, 1} == complex<int>{0, 0});
+    static_assert(2 * conj(complex<int>{1, 2}) == complex<int>{2, -4});
+    static_assert(norm(complex<int>{3, 4}) == 25);
+
     template<typename number_t>
     constexpr decltype(auto) make_complex(number_t &&real, number_t &&imag){
-        return complex<number_t>{std::forward<number_t>(real), std::forward<number_t>(imag)};
+        using value_t = typename std::remove_cvref<number_t>::type;
+        return complex<value_t>{std::forward<number_t>(real), std::forward<number_t>(imag)};
     }
 
     static_assert(make_complex(0, 0).real == 0);
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "constexpr_math.h"
+#include "cpu_features.h"
+
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+
+#if HAS_X86_SIMD
+#include <immintrin.h>
+#endif
+
+// Evaluates fast_trig over whole arrays of angles.
+// Linearly interpolated double tables use AVX2 gathers when the CPU has them,
+// everything else runs the scalar lookup in a loop.
+namespace constexpr_math::batch {
+    namespace detail {
+#if HAS_X86_SIMD
+        // fast_trig::reduce for angles below exact_reduction_from, 4 at a time
+        SIMD_TARGET("avx2")
+        inline __m256d reduce_avx2(__m256d deg) noexcept {
+            const auto full = _mm256_set1_pd(360);
+            auto reduced = _mm256_sub_pd(deg, _mm256_mul_pd(_mm256_floor_pd(_mm256_div_pd(deg, full)), full));
+            reduced = _mm256_add_pd(reduced, _mm256_and_pd(_mm256_cmp_pd(reduced, _mm256_setzero_pd(), _CMP_LT_OQ), full));
+            return _mm256_sub_pd(reduced, _mm256_and_pd(_mm256_cmp_pd(reduced, full, _CMP_GE_OQ), full));
+        }
+
+        // Same arithmetic as fast_trig::cos and sin, 4 angles at a time, over whole groups of 4,
+        // so the results are identical. Returns whether any angle was at least max_angle
+        // (or not finite): those results are meaningless, though every gather stays
+        // inside the table, and the caller has to recompute them with the exact reduction.
+        SIMD_TARGET("avx2")
+        inline bool cos_linear_avx2(const double *table, int nof_values, double precision, bool sine,
+                                    double max_angle, std::span<const double> degrees, std::span<double> out) noexcept {
+            const auto scale = _mm256_set1_pd(precision);
+            const auto last_index = _mm256_set1_pd(nof_values - 1);
+            const auto limit = _mm256_set1_pd(max_angle);
+            const auto sign = _mm256_set1_pd(-0.0);
+            const auto quarter = _mm256_set1_pd(90);
+            // Masked gathers with a zero source: the unmasked form trips -Wmaybe-uninitialized on GCC
+            const auto zero = _mm256_setzero_pd();
+            const auto all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+            auto out_of_range = zero;
+            for (size_t i = 0; i + 4 <= degrees.size(); i += 4){
+                const auto deg = _mm256_loadu_pd(degrees.data() + i);
+                out_of_range = _mm256_or_pd(out_of_range,
+                    _mm256_cmp_pd(_mm256_andnot_pd(sign, deg), limit, _CMP_NLT_UQ));
+                auto reduced = reduce_avx2(deg);
+                if (sine)
+                    reduced = reduce_avx2(_mm256_sub_pd(reduced, quarter));
+                const auto x = _mm256_mul_pd(reduced, scale);
+                // The multiplication can round up to nof_values, and out of range
+                // angles land anywhere (NaN picks last_index), so the index is clamped
+                const auto index = _mm256_max_pd(zero, _mm256_min_pd(_mm256_floor_pd(x), last_index));
+                const auto t = _mm256_sub_pd(x, index);
+                const auto index32 = _mm256_cvtpd_epi32(index);
+                const auto c0 = _mm256_mask_i32gather_pd(zero, table, index32, all, 8);
+                const auto c1 = _mm256_mask_i32gather_pd(zero, table + 1, index32, all, 8);
+                _mm256_storeu_pd(out.data() + i, _mm256_add_pd(c0, _mm256_mul_pd(_mm256_sub_pd(c1, c0), t)));
+            }
+            return _mm256_movemask_pd(out_of_range) != 0;
+        }
+#endif
+
+        template<unsigned short precision_v, typename number_t, interpolation interpolation_v>
+        void evaluate(const fast_trig<precision_v, number_t, interpolation_v> &trig, bool sine,
+                      std::span<const number_t> degrees, std::span<number_t> out) {
+            if (out.size() < degrees.size())
+                throw std::runtime_error("Output range is smaller than the input range");
+            const auto scalar = [&trig, sine](const number_t &deg){
+                return sine ? trig.sin(deg) : trig.cos(deg);
+            };
+#if HAS_X86_SIMD
+            if constexpr (std::is_same<number_t, double>::value && interpolation_v == interpolation::linear){
+                if (active_simd_level().load(std::memory_order_relaxed) == simd_level::avx2){
+                    const auto vectorised = degrees.size() / 4 * 4;
+                    const auto max_angle = trig.exact_reduction_from;
+                    if (cos_linear_avx2(trig.data(), trig.nof_values, precision_v, sine, max_angle, degrees, out)){
+                        for (size_t i = 0; i < vectorised; ++i)
+                            if (!(constexpr_math::abs(degrees[i]) < max_angle))
+                                out[i] = scalar(degrees[i]);
+                    }
+                    for (size_t i = vectorised; i < degrees.size(); ++i)
+                        out[i] = scalar(degrees[i]);
+                    return;
+                }
+            }
+#endif
+            for (size_t i = 0; i < degrees.size(); ++i)
+                out[i] = scalar(degrees[i]);
+        }
+    }
+
+    template<unsigned short precision_v, typename number_t, interpolation interpolation_v>
+    void cos(const fast_trig<precision_v, number_t, interpolation_v> &trig,
+             std::type_identity_t<std::span<const number_t>> degrees,
+             std::type_identity_t<std::span<number_t>> out) {
+        detail::evaluate(trig, false, degrees, out);
+    }
+
+    template<unsigned short precision_v, typename number_t, interpolation interpolation_v>
+    void sin(const fast_trig<precision_v, number_t, interpolation_v> &trig,
+             std::type_identity_t<std::span<const number_t>> degrees,
+             std::type_identity_t<std::span<number_t>> out) {
+        detail::evaluate(trig, true, degrees, out);
+    }
+}
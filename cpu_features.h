@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+
+// x86 SIMD kernels are compiled per function with target attributes,
+// so the rest of the program doesn't need -mavx2.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define HAS_X86_SIMD 1
+#define SIMD_TARGET(isa) __attribute__((target(isa)))
+#else
+#define HAS_X86_SIMD 0
+#define SIMD_TARGET(isa)
+#endif
+
+// Instruction sets the batch kernels know how to use, in increasing order
+enum class simd_level { scalar, sse4_2, avx2 };
+
+inline simd_level detect_simd_level() noexcept {
+#if HAS_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return simd_level::avx2;
+    if (__builtin_cpu_supports("sse4.2"))
+        return simd_level::sse4_2;
+#endif
+    return simd_level::scalar;
+}
+
+// Highest instruction set batch kernels will dispatch to.
+// Detected once at startup, can be lowered e.g. to compare implementations.
+inline std::atomic<simd_level> &active_simd_level() noexcept {
+    static std::atomic<simd_level> level{detect_simd_level()};
+    return level;
+}
+
+// Never goes above what the CPU supports
+inline void set_simd_level(simd_level level) noexcept {
+    const auto detected = detect_simd_level();
+    active_simd_level().store(level < detected ? level : detected, std::memory_order_relaxed);
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include "executor.h"
 #include "executor_resumer.h"
+#include "task_name.h"
 
 #include <atomic>
 #include <cassert>
@@ -119,7 +120,8 @@ class ctask {
 template<TaskResult result_t>
 struct ctask<result_t>::state : public executable {
     void execute() noexcept override {
-        ctask_debug(" [Resuming on executor thread] ");
+        if (task_tracing_enabled())
+            ctask_debug(" [Resuming on executor thread] ");
         handle.resume();
     }
 
@@ -132,8 +134,10 @@ struct ctask<result_t>::state : public executable {
 template<TaskResult result_t>
 struct ctask<result_t>::coroutine_promise {
 
-    void debug(std::string msg){
-        ctask_debug(name_ + " [" + msg + "]");
+    // Names are only formatted while tracing, so the usual path doesn't allocate
+    void debug(std::string_view msg){
+        if (task_tracing_enabled())
+            ctask_debug(std::string{name_.name()} + " [" + std::string{msg} + "]");
     }
 
     auto get_return_object() {
@@ -171,7 +175,8 @@ struct ctask<result_t>::coroutine_promise {
         return ctask_awaiter<other_task_t>{std::move(other_task)};
     }
 
-    auto await_transform(std::string name){
+    // co_await "name" labels the coroutine
+    auto await_transform(task_name_id name){
         name_ = name;
         return std::experimental::suspend_never{};
     }
@@ -184,6 +189,6 @@ struct ctask<result_t>::coroutine_promise {
 
     private:
     std::weak_ptr<state> shared_state_;
-    std::string name_;
+    task_name_id name_;
 };
 
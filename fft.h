@@ -0,0 +1,241 @@
+#pragma once
+
+#include "constexpr_approx.h"
+#include "constexpr_math.h"
+
+#include <array>
+#include <bit>
+#include <concepts>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace constexpr_math {
+    // Complex numbers stored as a structure of arrays: real and imaginary
+    // parts are separate contiguous arrays, so loops over them vectorise
+    // without shuffling interleaved pairs.
+    template<typename number_t>
+    class complex_array {
+        public:
+        complex_array() = default;
+
+        explicit complex_array(size_t size)
+            : real_(size), imag_(size)
+            {}
+
+        // Real signal, e.g. a price series
+        explicit complex_array(std::span<const number_t> real)
+            : real_(real.begin(), real.end()), imag_(real.size())
+            {}
+
+        size_t size() const noexcept {
+            return real_.size();
+        }
+
+        complex<number_t> operator[](size_t index) const {
+            return {real_[index], imag_[index]};
+        }
+
+        void set(size_t index, const complex<number_t> &value){
+            real_[index] = value.real;
+            imag_[index] = value.imag;
+        }
+
+        void push_back(const complex<number_t> &value){
+            real_.push_back(value.real);
+            imag_.push_back(value.imag);
+        }
+
+        void resize(size_t size){
+            real_.resize(size);
+            imag_.resize(size);
+        }
+
+        std::span<number_t> real() noexcept { return real_; }
+        std::span<number_t> imag() noexcept { return imag_; }
+        std::span<const number_t> real() const noexcept { return real_; }
+        std::span<const number_t> imag() const noexcept { return imag_; }
+
+        private:
+        std::vector<number_t> real_;
+        std::vector<number_t> imag_;
+    };
+
+    namespace detail {
+        constexpr size_t reverse_bits(size_t value, int nof_bits){
+            size_t result = 0;
+            for (auto i = 0; i < nof_bits; ++i, value >>= 1)
+                result = (result << 1) | (value & 1);
+            return result;
+        }
+
+        // Twiddle factors of all radix-2 stages, one after another:
+        // the stage combining halves of size h uses e^(-i pi k / h), k < h,
+        // stored at [h - 1, 2h - 1). Each stage reads its factors contiguously.
+        template<std::floating_point number_t>
+        constexpr void fill_twiddles(number_t *cos_out, number_t *sin_out, size_t size){
+            for (size_t half = 1; half < size; half *= 2){
+                for (size_t k = 0; k < half; ++k){
+                    const auto angle = -number_t{pi} * k / half;
+                    cos_out[half - 1 + k] = approx::cos(angle);
+                    sin_out[half - 1 + k] = approx::sin(angle);
+                }
+            }
+        }
+
+        // Iterative radix-2 decimation in time, in place over separate real
+        // and imaginary arrays. The inverse transform is not scaled.
+        template<std::floating_point number_t>
+        constexpr void fft_in_place(number_t *re, number_t *im, size_t size,
+                                    const number_t *tw_cos, const number_t *tw_sin, bool inverse){
+            const auto nof_bits = std::countr_zero(size);
+            for (size_t i = 0; i < size; ++i){
+                const auto j = reverse_bits(i, nof_bits);
+                if (i < j){
+                    std::swap(re[i], re[j]);
+                    std::swap(im[i], im[j]);
+                }
+            }
+
+            const number_t sign = inverse ? -1 : 1;
+            for (size_t half = 1; half < size; half *= 2){
+                const auto w_re = tw_cos + half - 1;
+                const auto w_im = tw_sin + half - 1;
+                for (size_t start = 0; start < size; start += 2 * half){
+                    auto a_re = re + start;
+                    auto a_im = im + start;
+                    auto b_re = a_re + half;
+                    auto b_im = a_im + half;
+                    for (size_t k = 0; k < half; ++k){
+                        const auto wi = sign * w_im[k];
+                        const auto t_re = b_re[k] * w_re[k] - b_im[k] * wi;
+                        const auto t_im = b_re[k] * wi + b_im[k] * w_re[k];
+                        b_re[k] = a_re[k] - t_re;
+                        b_im[k] = a_im[k] - t_im;
+                        a_re[k] += t_re;
+                        a_im[k] += t_im;
+                    }
+                }
+            }
+        }
+    }
+
+    // Twiddle factors for a transform of a fixed size, computed at compile time
+    template<size_t size_v, std::floating_point number_t>
+    struct twiddle_table {
+        static_assert(std::has_single_bit(size_v), "FFT size must be a power of two");
+
+        static constexpr auto size = size_v;
+        static constexpr auto nof_values = size_v > 1 ? size_v - 1 : 1;
+
+        number_t cos[nof_values] = {};
+        number_t sin[nof_values] = {};
+
+        constexpr twiddle_table(){
+            detail::fill_twiddles(cos, sin, size_v);
+        }
+    };
+
+    // Compile-time transform of a fixed-size array
+    template<size_t size_v, std::floating_point number_t>
+    constexpr auto fft(const std::array<complex<number_t>, size_v> &values, bool inverse = false){
+        constexpr twiddle_table<size_v, number_t> twiddles{};
+        number_t re[size_v] = {};
+        number_t im[size_v] = {};
+        for (size_t i = 0; i < size_v; ++i){
+            re[i] = values[i].real;
+            im[i] = values[i].imag;
+        }
+        detail::fft_in_place(re, im, size_v, twiddles.cos, twiddles.sin, inverse);
+
+        std::array<complex<number_t>, size_v> result{};
+        for (size_t i = 0; i < size_v; ++i)
+            result[i] = inverse ? complex<number_t>{re[i] / size_v, im[i] / size_v}
+                                : complex<number_t>{re[i], im[i]};
+        return result;
+    }
+
+    // Reusable run-time transform of one size, in place over a complex_array
+    template<std::floating_point number_t>
+    class fft_plan {
+        public:
+        // Twiddle factors are computed at run time
+        explicit fft_plan(size_t size)
+            : size_{size}, cos_(size > 1 ? size - 1 : 1), sin_(size > 1 ? size - 1 : 1)
+        {
+            if (!std::has_single_bit(size))
+                throw std::runtime_error("FFT size must be a power of two");
+            detail::fill_twiddles(cos_.data(), sin_.data(), size);
+        }
+
+        // Twiddle factors come from a table built at compile time
+        template<size_t size_v>
+        explicit fft_plan(const twiddle_table<size_v, number_t> &twiddles)
+            : size_{size_v}
+            , cos_(std::begin(twiddles.cos), std::end(twiddles.cos))
+            , sin_(std::begin(twiddles.sin), std::end(twiddles.sin))
+            {}
+
+        size_t size() const noexcept {
+            return size_;
+        }
+
+        void forward(complex_array<number_t> &data) const {
+            transform(data, false);
+        }
+
+        // Scaled by 1/size, so that inverse(forward(x)) == x
+        void inverse(complex_array<number_t> &data) const {
+            transform(data, true);
+            const auto scale = number_t{1} / size_;
+            for (auto &v: data.real())
+                v *= scale;
+            for (auto &v: data.imag())
+                v *= scale;
+        }
+
+        private:
+        void transform(complex_array<number_t> &data, bool inverse) const {
+            if (data.size() != size_)
+                throw std::runtime_error("Data size doesn't match the FFT plan");
+            detail::fft_in_place(data.real().data(), data.imag().data(), size_,
+                                 cos_.data(), sin_.data(), inverse);
+        }
+
+        size_t size_;
+        std::vector<number_t> cos_;
+        std::vector<number_t> sin_;
+    };
+
+    // |X_k|^2 of a transformed signal
+    template<typename number_t>
+    std::vector<number_t> power_spectrum(const complex_array<number_t> &data){
+        std::vector<number_t> result(data.size());
+        const auto re = data.real();
+        const auto im = data.imag();
+        for (size_t i = 0; i < result.size(); ++i)
+            result[i] = re[i] * re[i] + im[i] * im[i];
+        return result;
+    }
+}
+
+namespace constexpr_math::test {
+    template<size_t size_v>
+    using signal = std::array<complex<double>, size_v>;
+
+    template<size_t size_v>
+    constexpr bool equal(const signal<size_v> &a, const signal<size_v> &b){
+        for (size_t i = 0; i < size_v; ++i)
+            if (!constexpr_math::equal(a[i], b[i]))
+                return false;
+        return true;
+    }
+
+    static_assert(equal(fft(signal<4>{{{1, 0}, {1, 0}, {1, 0}, {1, 0}}}), signal<4>{{{4, 0}, {0, 0}, {0, 0}, {0, 0}}}));
+    static_assert(equal(fft(signal<4>{{{1, 0}, {0, 0}, {0, 0}, {0, 0}}}), signal<4>{{{1, 0}, {1, 0}, {1, 0}, {1, 0}}}));
+    static_assert(equal(fft(signal<4>{{{0, 0}, {1, 0}, {0, 0}, {0, 0}}}), signal<4>{{{1, 0}, {0, -1}, {-1, 0}, {0, 1}}}));
+
+    constexpr auto x = signal<8>{{{1, 2}, {3, 4}, {-5, 6}, {7, 0}, {0, 1}, {2, 2}, {4, -3}, {9, 9}}};
+    static_assert(equal(fft(fft(x), true), x));
+}
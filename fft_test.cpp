@@ -0,0 +1,121 @@
+#include "fft.h"
+#include "test_check.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+    using constexpr_math::complex;
+    using constexpr_math::complex_array;
+    using constexpr_math::fft_plan;
+
+    // Deterministic values in [-1, 1)
+    complex_array<double> make_signal(size_t size){
+        complex_array<double> signal(size);
+        std::uint64_t state = 42;
+        const auto next = [&state]{
+            state = state * 6364136223846793005 + 1442695040888963407;
+            return static_cast<double>(state >> 11) / (1ull << 52) - 1;
+        };
+        for (size_t i = 0; i < size; ++i)
+            signal.set(i, {next(), next()});
+        return signal;
+    }
+
+    // Direct O(n^2) DFT in long double
+    complex_array<double> direct_dft(const complex_array<double> &signal){
+        const auto size = signal.size();
+        complex_array<double> result(size);
+        for (size_t k = 0; k < size; ++k){
+            long double re = 0;
+            long double im = 0;
+            for (size_t j = 0; j < size; ++j){
+                const auto angle = -2 * std::numbers::pi_v<long double> * ((j * k) % size) / size;
+                const auto c = std::cos(angle);
+                const auto s = std::sin(angle);
+                re += signal[j].real * c - signal[j].imag * s;
+                im += signal[j].real * s + signal[j].imag * c;
+            }
+            result.set(k, {static_cast<double>(re), static_cast<double>(im)});
+        }
+        return result;
+    }
+
+    // Largest difference in any component, relative to the largest component
+    double max_difference(const complex_array<double> &a, const complex_array<double> &b){
+        double difference = 0;
+        double scale = 1;
+        for (size_t i = 0; i < a.size(); ++i){
+            difference = std::max({difference, std::abs(a[i].real - b[i].real), std::abs(a[i].imag - b[i].imag)});
+            scale = std::max({scale, std::abs(b[i].real), std::abs(b[i].imag)});
+        }
+        return difference / scale;
+    }
+
+    void forward_matches_direct_dft(){
+        for (size_t size = 1; size <= 1024; size *= 2){
+            const auto signal = make_signal(size);
+            auto transformed = signal;
+            const fft_plan<double> plan{size};
+            plan.forward(transformed);
+            check(max_difference(transformed, direct_dft(signal)) < 1e-13, "forward matches direct DFT");
+
+            plan.inverse(transformed);
+            check(max_difference(transformed, signal) < 1e-14, "inverse of forward round trips");
+        }
+    }
+
+    void plan_from_twiddle_table(){
+        static constexpr constexpr_math::twiddle_table<64, double> twiddles{};
+        const fft_plan<double> compile_time{twiddles};
+        const fft_plan<double> run_time{64};
+        check(compile_time.size() == 64, "plan size from twiddle table");
+
+        const auto signal = make_signal(64);
+        auto a = signal;
+        auto b = signal;
+        compile_time.forward(a);
+        run_time.forward(b);
+        check(max_difference(a, direct_dft(signal)) < 1e-13, "twiddle table plan matches direct DFT");
+        check(max_difference(a, b) < 1e-15, "twiddle table plan matches run-time plan");
+
+        compile_time.inverse(a);
+        check(max_difference(a, signal) < 1e-14, "twiddle table plan round trips");
+    }
+
+    void power_spectrum_of_a_tone(){
+        // cos(2 pi 5 t / 32) puts half its power in bins 5 and 27
+        constexpr size_t size = 32;
+        std::vector<double> samples(size);
+        for (size_t i = 0; i < size; ++i)
+            samples[i] = std::cos(2 * std::numbers::pi * 5 * i / size);
+        complex_array<double> signal{samples};
+        fft_plan<double>{size}.forward(signal);
+        const auto power = constexpr_math::power_spectrum(signal);
+        auto rest = 0.0;
+        for (size_t i = 0; i < size; ++i)
+            rest += i == 5 || i == 27 ? 0 : power[i];
+        check(std::abs(power[5] - 256) < 1e-9 && std::abs(power[27] - 256) < 1e-9, "power in the tone's bins");
+        check(rest < 1e-20, "no power elsewhere");
+    }
+
+    void invalid_sizes(){
+        check(throws<std::runtime_error>([]{ fft_plan<double>{0}; }), "size 0 throws");
+        check(throws<std::runtime_error>([]{ fft_plan<double>{48}; }), "size that isn't a power of two throws");
+        auto signal = make_signal(16);
+        check(throws<std::runtime_error>([&]{ fft_plan<double>{32}.forward(signal); }), "size mismatch throws");
+    }
+}
+
+int main(){
+    forward_matches_direct_dft();
+    plan_from_twiddle_table();
+    power_spectrum_of_a_tone();
+    invalid_sizes();
+
+    return test_exit_code();
+}
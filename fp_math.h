@@ -2,7 +2,33 @@
 
 #include "constexpr_math.h"
 
+#include <charconv>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+
 namespace fp_math {
+    // Converts a raw value between precisions, rounding half away from zero.
+    // Values too large for the higher precision saturate at the limits of long long.
+    template<unsigned short to_precision_v, unsigned short from_precision_v>
+    constexpr long long rescale_raw(long long raw) noexcept{
+        if constexpr (to_precision_v >= from_precision_v){
+            long long scaled = 0;
+            if (__builtin_mul_overflow(raw, constexpr_math::pow(10ll, to_precision_v - from_precision_v), &scaled))
+                return raw < 0 ? std::numeric_limits<long long>::min() : std::numeric_limits<long long>::max();
+            return scaled;
+        }
+        else {
+            constexpr auto divisor = constexpr_math::pow(10ll, from_precision_v - to_precision_v);
+            const auto half = raw < 0 ? -divisor / 2 : divisor / 2;
+            return (raw + half) / divisor;
+        }
+    }
+
     template<unsigned short precision_v = 4>
     class number {
         public:
@@ -14,23 +40,49 @@ namespace fp_math {
 
 
 
+        // Rounds to the nearest representable value.
+        // Use parse() or from_chars() to get exact decimal values.
         template<typename fp_type>
+        requires std::is_arithmetic<fp_type>::value
         constexpr number(const fp_type &value) noexcept{
             value_ = static_cast<storage_type>(value) * offset;
-            value_ += static_cast<storage_type>(
-                (value - static_cast<storage_type>(value)) * offset);
+            const auto frac = (value - static_cast<storage_type>(value)) * offset;
+            value_ += static_cast<storage_type>(frac < 0 ? frac - 0.5 : frac + 0.5);
         }
 
+        // Converts from another precision, rounding half away from zero.
+        // Saturates when the value doesn't fit the higher precision.
+        template<unsigned short other_precision_v>
+        requires (other_precision_v != precision_v)
+        constexpr explicit number(const number<other_precision_v> &other) noexcept
+            : value_{rescale_raw<precision_v, other_precision_v>(other.raw())}
+            {}
+
         constexpr storage_type int_part() const noexcept{
             return value_ / offset;
         }
 
         constexpr storage_type frac_part() const  noexcept{
-            return value_ % (int_part() * offset);
+            return value_ % offset;
         }
 
         constexpr number() = default;
 
+        // Raw fixed-point representation, i.e. value * offset
+        constexpr storage_type raw() const noexcept{
+            return value_;
+        }
+
+        constexpr static same_precision_number from_raw(storage_type raw) noexcept{
+            same_precision_number n;
+            n.value_ = raw;
+            return n;
+        }
+
+        explicit constexpr operator double() const noexcept{
+            return static_cast<double>(value_) / offset;
+        }
+
         constexpr auto operator==(const same_precision_number &other) const noexcept{
             return value_ == other.value_;
         }
@@ -68,6 +120,197 @@ namespace fp_math {
         private:
         storage_type value_ = 0;
     };
+
+    template<unsigned short to_precision_v, unsigned short from_precision_v>
+    constexpr number<to_precision_v> rescale(const number<from_precision_v> &value) noexcept{
+        return number<to_precision_v>{value};
+    }
+
+    namespace detail {
+        constexpr bool is_digit(char c) noexcept{
+            return c >= '0' && c <= '9';
+        }
+
+        // Little-endian load, written so that it's usable in constant expressions.
+        // Compilers turn this into a single 8-byte load.
+        constexpr std::uint64_t load_eight_chars(const char *p) noexcept{
+            std::uint64_t v = 0;
+            for (auto i = 0; i < 8; ++i)
+                v |= static_cast<std::uint64_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+            return v;
+        }
+
+        // SWAR: checks 8 characters at once
+        constexpr bool is_eight_digits(std::uint64_t v) noexcept{
+            return ((v & 0xF0F0F0F0F0F0F0F0) |
+                    (((v + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) == 0x3333333333333333;
+        }
+
+        // SWAR: converts 8 digits with 3 multiplications instead of 8
+        constexpr std::uint32_t parse_eight_digits(std::uint64_t v) noexcept{
+            constexpr std::uint64_t mask = 0x000000FF000000FF;
+            constexpr std::uint64_t mul1 = 100 + (1000000ull << 32);
+            constexpr std::uint64_t mul2 = 1 + (10000ull << 32);
+            v -= 0x3030303030303030;
+            v = (v * 10) + (v >> 8);
+            return static_cast<std::uint32_t>(
+                (((v & mask) * mul1) + (((v >> 16) & mask) * mul2)) >> 32);
+        }
+
+        // Consumes at most max_digits digits from p, appending them to value.
+        // Returns false on overflow.
+        constexpr bool accumulate_digits(const char *&p, const char *last,
+                                         std::uint64_t &value, size_t max_digits) noexcept{
+            constexpr auto max = std::numeric_limits<std::uint64_t>::max();
+            while (max_digits >= 8 && last - p >= 8 && is_eight_digits(load_eight_chars(p))){
+                const auto chunk = parse_eight_digits(load_eight_chars(p));
+                if (value > (max - chunk) / 100000000)
+                    return false;
+                value = value * 100000000 + chunk;
+                p += 8;
+                max_digits -= 8;
+            }
+            for (; max_digits > 0 && p != last && is_digit(*p); ++p, --max_digits){
+                const auto digit = static_cast<std::uint64_t>(*p - '0');
+                if (value > (max - digit) / 10)
+                    return false;
+                value = value * 10 + digit;
+            }
+            return true;
+        }
+
+        // Skips the rest of [digits][.digits], so errors point past the whole number
+        constexpr const char *skip_number(const char *p, const char *last) noexcept{
+            while (p != last && is_digit(*p))
+                ++p;
+            if (p != last && *p == '.'){
+                ++p;
+                while (p != last && is_digit(*p))
+                    ++p;
+            }
+            return p;
+        }
+
+        constexpr char digit_pairs[] =
+            "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+            "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+            "8081828384858687888990919293949596979899";
+    }
+
+    // Parses [-]digits[.digits] exactly, without going through floating point.
+    // Fractional digits beyond the precision are rounded half away from zero.
+    // Same contract as std::from_chars: on error, result is left unchanged.
+    template<unsigned short precision_v>
+    constexpr std::from_chars_result from_chars(const char *first, const char *last,
+                                                number<precision_v> &result) noexcept{
+        using number_t = number<precision_v>;
+        auto p = first;
+        const auto negative = p != last && *p == '-';
+        if (negative)
+            ++p;
+
+        const auto int_begin = p;
+        std::uint64_t int_part = 0;
+        if (!detail::accumulate_digits(p, last, int_part, std::numeric_limits<size_t>::max()))
+            return {detail::skip_number(p, last), std::errc::result_out_of_range};
+        auto nof_digits = p - int_begin;
+
+        std::uint64_t frac_part = 0;
+        auto round_up = false;
+        if (p != last && *p == '.'){
+            const auto frac_begin = ++p;
+            detail::accumulate_digits(p, last, frac_part, precision_v);
+            for (auto i = p - frac_begin; i < precision_v; ++i)
+                frac_part *= 10;
+            round_up = p != last && *p >= '5' && *p <= '9';
+            while (p != last && detail::is_digit(*p))
+                ++p;
+            nof_digits += p - frac_begin;
+        }
+        if (nof_digits == 0)
+            return {first, std::errc::invalid_argument};
+
+        constexpr auto max = static_cast<std::uint64_t>(std::numeric_limits<long long>::max());
+        constexpr auto offset = static_cast<std::uint64_t>(number_t::offset);
+        if (int_part > max / offset)
+            return {p, std::errc::result_out_of_range};
+        // One more negative value than positive fits, e.g. to_chars of the raw minimum
+        const auto magnitude = int_part * offset + frac_part + round_up;
+        if (magnitude > max + negative)
+            return {p, std::errc::result_out_of_range};
+
+        // Negated as unsigned, so the minimum doesn't overflow; the conversion is modular
+        result = number_t::from_raw(static_cast<long long>(negative ? 0 - magnitude : magnitude));
+        return {p, std::errc{}};
+    }
+
+    template<unsigned short precision_v>
+    constexpr number<precision_v> parse(std::string_view text){
+        number<precision_v> result;
+        const auto [ptr, ec] = from_chars(text.data(), text.data() + text.size(), result);
+        if (ec != std::errc{} || ptr != text.data() + text.size())
+            throw std::runtime_error("Not a fixed-point number: " + std::string{text});
+        return result;
+    }
+
+    // Largest output of to_chars: sign, 19 digits and the decimal point
+    constexpr size_t max_chars = 21;
+
+    // Writes [-]int.frac with exactly precision fractional digits.
+    // Same contract as std::to_chars: nothing is null-terminated.
+    template<unsigned short precision_v>
+    constexpr std::to_chars_result to_chars(char *first, char *last,
+                                            const number<precision_v> &value) noexcept{
+        char buffer[max_chars];
+        auto end = buffer + max_chars;
+        auto p = end;
+
+        const auto negative = value.raw() < 0;
+        // Negate as unsigned so that the smallest long long works too
+        auto magnitude = static_cast<std::uint64_t>(value.raw());
+        if (negative)
+            magnitude = 0 - magnitude;
+
+        auto write_digits = [&p](std::uint64_t v, int min_digits){
+            while (v >= 100 || min_digits > 2){
+                const auto pair = v % 100;
+                v /= 100;
+                *--p = detail::digit_pairs[2 * pair + 1];
+                *--p = detail::digit_pairs[2 * pair];
+                min_digits -= 2;
+            }
+            if (v >= 10 || min_digits == 2){
+                *--p = detail::digit_pairs[2 * v + 1];
+                *--p = detail::digit_pairs[2 * v];
+            }
+            else {
+                *--p = static_cast<char>('0' + v);
+            }
+        };
+
+        constexpr auto offset = static_cast<std::uint64_t>(number<precision_v>::offset);
+        if constexpr (precision_v > 0){
+            write_digits(magnitude % offset, precision_v);
+            *--p = '.';
+        }
+        write_digits(magnitude / offset, 1);
+        if (negative)
+            *--p = '-';
+
+        const auto length = end - p;
+        if (last - first < length)
+            return {last, std::errc::value_too_large};
+        for (; p != end; ++p, ++first)
+            *first = *p;
+        return {first, std::errc{}};
+    }
+
+    template<unsigned short precision_v>
+    std::string to_string(const number<precision_v> &value){
+        char buffer[max_chars];
+        const auto [ptr, ec] = to_chars(buffer, buffer + max_chars, value);
+        return std::string(buffer, ptr);
+    }
 }
 
 namespace fp_math::test {
@@ -80,5 +323,59 @@ namespace fp_math::test {
 
     using n9 = number<9>;
     static_assert(constexpr_math::equal(n9{42}, n9{42.0000001}));
-    static_assert(n9{42} == n9{42.0000001});
+    static_assert(!(n9{42} == n9{42.0000001}));
+    static_assert(n9{42.0000001} == parse<9>("42.0000001"));
+
+    static_assert(n4{0.5}.frac_part() == 5000);
+    static_assert(static_cast<double>(n4{-2.5}) == -2.5);
+    static_assert(n4{1.0009}.raw() == 10009);
+    static_assert(n4{n9{-1.23456}} == n4{-1.2346});
+
+    static_assert(n4::from_raw(123456).raw() == 123456);
+    static_assert(rescale<2>(n4::from_raw(123456)).raw() == 1235);
+    static_assert(rescale<2>(n4::from_raw(-123450)).raw() == -1235);
+    static_assert(rescale<6>(n4::from_raw(-123456)).raw() == -12345600);
+    static_assert(n9{n4{1e10}}.raw() == std::numeric_limits<long long>::max());
+    static_assert(n9{n4{-1e10}}.raw() == std::numeric_limits<long long>::min());
+    static_assert(n9{n4{9e9}}.raw() == 9'000'000'000'000'000'000);
+
+    static_assert(parse<4>("101.93").raw() == 1019300);
+    static_assert(parse<4>("-0.00005").raw() == -1);
+    static_assert(parse<4>("3.14159").raw() == 31416);
+    static_assert(parse<4>("12345678901234.5").raw() == 123456789012345000);
+    static_assert(parse<4>(".5") == n4{0.5});
+    static_assert(parse<0>("7.5").raw() == 8);
+
+    constexpr auto parse_error(std::string_view text){
+        n4 n;
+        return from_chars(text.data(), text.data() + text.size(), n).ec;
+    }
+    static_assert(parse_error("-") == std::errc::invalid_argument);
+    static_assert(parse_error("x1") == std::errc::invalid_argument);
+    static_assert(parse_error("922337203685477.5808") == std::errc::result_out_of_range);
+    static_assert(parse_error("-922337203685477.5809") == std::errc::result_out_of_range);
+    static_assert(parse<4>("-922337203685477.5808").raw() == std::numeric_limits<long long>::min());
+    static_assert(parse<4>("-922337203685477.5807").raw() == std::numeric_limits<long long>::min() + 1);
+    static_assert(parse_error("99999999999999999999999") == std::errc::result_out_of_range);
+
+    // Errors point past the whole number, like std::from_chars
+    constexpr auto parse_end(std::string_view text){
+        n4 n;
+        return from_chars(text.data(), text.data() + text.size(), n).ptr - text.data();
+    }
+    static_assert(parse_end("99999999999999999999999.25x") == 26);
+    static_assert(parse_end("-123456789012345678901234567") == 28);
+    static_assert(parse_end("922337203685477.5808 ") == 20);
+
+    template<unsigned short precision_v>
+    constexpr bool formats_as(const number<precision_v> &value, std::string_view expected){
+        char buffer[max_chars] = {};
+        const auto [ptr, ec] = to_chars(buffer, buffer + max_chars, value);
+        return ec == std::errc{} && std::string_view(buffer, ptr - buffer) == expected;
+    }
+    static_assert(formats_as(n4::from_raw(-1019300), "-101.9300"));
+    static_assert(formats_as(n4::from_raw(5), "0.0005"));
+    static_assert(formats_as(number<0>::from_raw(-42), "-42"));
+    static_assert(formats_as(n4::from_raw(std::numeric_limits<long long>::min()), "-922337203685477.5808"));
+    static_assert(formats_as(parse<4>("1234567.89"), "1234567.8900"));
 }
@@ -0,0 +1,486 @@
+#pragma once
+
+#include "cpu_features.h"
+#include "fp_math.h"
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#if HAS_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace fp_math {
+    template<typename T>
+    struct is_number : std::false_type {};
+
+    template<unsigned short precision_v>
+    struct is_number<number<precision_v>> : std::true_type {};
+
+    // Contiguous range of fixed-point numbers, e.g. std::span<number<4>> or std::vector<number<4>>
+    template<typename R>
+    concept NumberRange = std::ranges::contiguous_range<R> &&
+        is_number<std::remove_cv_t<std::ranges::range_value_t<R>>>::value;
+}
+
+// Operations over whole arrays of fixed-point numbers.
+// number<P> is a single long long, so an array of them is processed as int64 SIMD lanes.
+// The implementation is picked at run time: AVX2, SSE4.2 or scalar.
+namespace fp_math::batch {
+    namespace detail {
+        using raw_t = long long;
+
+        static_assert(sizeof(number<4>) == sizeof(raw_t));
+        static_assert(std::is_standard_layout<number<4>>::value);
+
+        template<NumberRange range_t>
+        using number_of = std::remove_cv_t<std::ranges::range_value_t<range_t>>;
+
+        template<NumberRange range_t>
+        auto raw_span(range_t &&values) noexcept {
+            using value_t = std::remove_reference_t<std::ranges::range_reference_t<range_t>>;
+            using raw_value_t = std::conditional_t<std::is_const<value_t>::value, const raw_t, raw_t>;
+            return std::span<raw_value_t>{
+                reinterpret_cast<raw_value_t*>(std::ranges::data(values)), std::ranges::size(values)};
+        }
+
+        inline simd_level level() noexcept {
+            return active_simd_level().load(std::memory_order_relaxed);
+        }
+
+#if defined(__SIZEOF_INT128__)
+        using wide_t = __int128;
+
+        constexpr wide_t multiply(raw_t a, raw_t b) noexcept {
+            return static_cast<wide_t>(a) * b;
+        }
+
+        // Divides by a positive divisor, rounding half away from zero
+        constexpr raw_t round_div(wide_t value, raw_t divisor) noexcept {
+            const auto half = value < 0 ? -divisor / 2 : divisor / 2;
+            return static_cast<raw_t>((value + half) / divisor);
+        }
+#else
+        // Targets without __int128, e.g. 32-bit x86: a two's complement
+        // 128-bit integer with just what the dot product needs
+        struct wide_t {
+            std::uint64_t low = 0;
+            std::uint64_t high = 0;
+
+            constexpr wide_t() = default;
+
+            constexpr wide_t(raw_t value) noexcept
+                : low{static_cast<std::uint64_t>(value)}
+                , high{value < 0 ? ~std::uint64_t{0} : 0}
+                {}
+
+            constexpr bool negative() const noexcept {
+                return (high >> 63) != 0;
+            }
+
+            constexpr wide_t operator-() const noexcept {
+                wide_t n;
+                n.low = ~low + 1;
+                n.high = ~high + (n.low == 0);
+                return n;
+            }
+
+            constexpr wide_t &operator+=(const wide_t &other) noexcept {
+                low += other.low;
+                high += other.high + (low < other.low);
+                return *this;
+            }
+
+            constexpr bool operator==(const wide_t&) const = default;
+        };
+
+        // Long multiplication of the magnitudes in 32-bit halves, then the sign
+        constexpr wide_t multiply(raw_t a, raw_t b) noexcept {
+            const auto magnitude = [](raw_t v){
+                return v < 0 ? ~static_cast<std::uint64_t>(v) + 1 : static_cast<std::uint64_t>(v);
+            };
+            const auto ma = magnitude(a);
+            const auto mb = magnitude(b);
+            const auto lo_lo = (ma & 0xffffffff) * (mb & 0xffffffff);
+            const auto hi_lo = (ma >> 32) * (mb & 0xffffffff);
+            const auto lo_hi = (ma & 0xffffffff) * (mb >> 32);
+            const auto hi_hi = (ma >> 32) * (mb >> 32);
+            const auto middle = (lo_lo >> 32) + (hi_lo & 0xffffffff) + (lo_hi & 0xffffffff);
+
+            wide_t product;
+            product.low = (middle << 32) | (lo_lo & 0xffffffff);
+            product.high = hi_hi + (hi_lo >> 32) + (lo_hi >> 32) + (middle >> 32);
+            return (a < 0) != (b < 0) ? -product : product;
+        }
+
+        // Divides by a positive divisor, rounding half away from zero.
+        // Bitwise long division: only done once per dot product.
+        constexpr raw_t round_div(wide_t value, raw_t divisor) noexcept {
+            const auto negative = value.negative();
+            auto magnitude = negative ? -value : value;
+            magnitude += wide_t{divisor / 2};
+
+            const auto d = static_cast<std::uint64_t>(divisor);
+            std::uint64_t quotient = 0;
+            std::uint64_t remainder = 0;
+            for (int bit = 127; bit >= 0; --bit){
+                const auto word = bit >= 64 ? magnitude.high : magnitude.low;
+                // remainder < d <= 2^63, so this can't overflow
+                remainder = (remainder << 1) | ((word >> (bit % 64)) & 1);
+                quotient <<= 1;
+                if (remainder >= d){
+                    remainder -= d;
+                    quotient |= 1;
+                }
+            }
+            const auto result = static_cast<raw_t>(quotient);
+            return negative ? -result : result;
+        }
+#endif
+
+        // Scalar kernels. Also used for the tails of the vector kernels.
+        constexpr raw_t sum_scalar(std::span<const raw_t> values) noexcept {
+            raw_t sum = 0;
+            for (auto v: values)
+                sum += v;
+            return sum;
+        }
+
+        // There is no 64x64->128 bit multiply in AVX2, so dot product is always scalar
+        constexpr wide_t dot_scalar(std::span<const raw_t> a, std::span<const raw_t> b) noexcept {
+            wide_t sum = 0;
+            for (size_t i = 0; i < a.size(); ++i)
+                sum += multiply(a[i], b[i]);
+            return sum;
+        }
+
+        template<bool take_min>
+        constexpr raw_t extreme_scalar(std::span<const raw_t> values, raw_t init) noexcept {
+            for (auto v: values)
+                init = (take_min ? v < init : v > init) ? v : init;
+            return init;
+        }
+
+        constexpr size_t greater_mask_scalar(std::span<const raw_t> values, raw_t threshold, std::uint8_t *mask) noexcept {
+            size_t count = 0;
+            for (size_t i = 0; i < values.size(); ++i){
+                mask[i] = values[i] > threshold;
+                count += mask[i];
+            }
+            return count;
+        }
+
+        // Branchless compaction: always writes, only advances when selected.
+        // out must have room for values.size() elements.
+        constexpr size_t copy_greater_scalar(std::span<const raw_t> values, raw_t threshold, raw_t *out) noexcept {
+            size_t count = 0;
+            for (auto v: values){
+                out[count] = v;
+                count += v > threshold;
+            }
+            return count;
+        }
+
+        static_assert(sum_scalar(std::array<raw_t, 3>{1, -2, 4}) == 3);
+        static_assert(round_div(dot_scalar(std::array<raw_t, 2>{3'000'000'000, 2}, std::array<raw_t, 2>{3'000'000'000, 5}),
+                                1'000'000'000) == 9'000'000'000);
+        static_assert(round_div(dot_scalar(std::array<raw_t, 2>{-3'000'000'000, 2}, std::array<raw_t, 2>{3'000'000'000, 5}),
+                                10) == -899'999'999'999'999'999);
+        static_assert(round_div(multiply(-4'000'000'000'000, 5'000'000'000'000), 1'000'000'000'000'000'000) == -20'000'000);
+        static_assert(extreme_scalar<true>(std::array<raw_t, 3>{5, -7, 2}, 5) == -7);
+        static_assert(extreme_scalar<false>(std::array<raw_t, 3>{5, -7, 2}, 5) == 5);
+        static_assert(round_div(15, 10) == 2 && round_div(-15, 10) == -2 && round_div(14, 10) == 1);
+
+#if HAS_X86_SIMD
+        // Permutation of 32-bit lanes that moves the selected 64-bit lanes of
+        // a 4-lane vector to the front, indexed by the 4-bit compare mask
+        constexpr auto make_compress_table(){
+            std::array<std::array<int, 8>, 16> table{};
+            for (unsigned mask = 0; mask < 16; ++mask){
+                unsigned selected = 0;
+                for (unsigned lane = 0; lane < 4; ++lane){
+                    if (mask & (1u << lane)){
+                        table[mask][2 * selected] = 2 * lane;
+                        table[mask][2 * selected + 1] = 2 * lane + 1;
+                        ++selected;
+                    }
+                }
+            }
+            return table;
+        }
+
+        inline constexpr auto compress_table = make_compress_table();
+
+        SIMD_TARGET("avx2")
+        inline __m256i load4(const raw_t *p) noexcept {
+            return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        }
+
+        SIMD_TARGET("sse4.2")
+        inline __m128i load2(const raw_t *p) noexcept {
+            return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        }
+
+        SIMD_TARGET("avx2")
+        inline raw_t sum_avx2(std::span<const raw_t> values) noexcept {
+            auto acc0 = _mm256_setzero_si256();
+            auto acc1 = _mm256_setzero_si256();
+            size_t i = 0;
+            for (; i + 8 <= values.size(); i += 8){
+                acc0 = _mm256_add_epi64(acc0, load4(values.data() + i));
+                acc1 = _mm256_add_epi64(acc1, load4(values.data() + i + 4));
+            }
+            alignas(32) raw_t lanes[4];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), _mm256_add_epi64(acc0, acc1));
+            return lanes[0] + lanes[1] + lanes[2] + lanes[3] + sum_scalar(values.subspan(i));
+        }
+
+        SIMD_TARGET("sse4.2")
+        inline raw_t sum_sse(std::span<const raw_t> values) noexcept {
+            auto acc0 = _mm_setzero_si128();
+            auto acc1 = _mm_setzero_si128();
+            size_t i = 0;
+            for (; i + 4 <= values.size(); i += 4){
+                acc0 = _mm_add_epi64(acc0, load2(values.data() + i));
+                acc1 = _mm_add_epi64(acc1, load2(values.data() + i + 2));
+            }
+            alignas(16) raw_t lanes[2];
+            _mm_store_si128(reinterpret_cast<__m128i*>(lanes), _mm_add_epi64(acc0, acc1));
+            return lanes[0] + lanes[1] + sum_scalar(values.subspan(i));
+        }
+
+        // There is no 64-bit min/max before AVX-512: compare and blend instead
+        template<bool take_min>
+        SIMD_TARGET("avx2")
+        inline raw_t extreme_avx2(std::span<const raw_t> values, raw_t init) noexcept {
+            auto best = _mm256_set1_epi64x(init);
+            size_t i = 0;
+            for (; i + 4 <= values.size(); i += 4){
+                const auto v = load4(values.data() + i);
+                const auto replace = take_min ? _mm256_cmpgt_epi64(best, v) : _mm256_cmpgt_epi64(v, best);
+                best = _mm256_blendv_epi8(best, v, replace);
+            }
+            alignas(32) raw_t lanes[4];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), best);
+            return extreme_scalar<take_min>(lanes, extreme_scalar<take_min>(values.subspan(i), init));
+        }
+
+        template<bool take_min>
+        SIMD_TARGET("sse4.2")
+        inline raw_t extreme_sse(std::span<const raw_t> values, raw_t init) noexcept {
+            auto best = _mm_set1_epi64x(init);
+            size_t i = 0;
+            for (; i + 2 <= values.size(); i += 2){
+                const auto v = load2(values.data() + i);
+                const auto replace = take_min ? _mm_cmpgt_epi64(best, v) : _mm_cmpgt_epi64(v, best);
+                best = _mm_blendv_epi8(best, v, replace);
+            }
+            alignas(16) raw_t lanes[2];
+            _mm_store_si128(reinterpret_cast<__m128i*>(lanes), best);
+            return extreme_scalar<take_min>(lanes, extreme_scalar<take_min>(values.subspan(i), init));
+        }
+
+        SIMD_TARGET("avx2")
+        inline size_t greater_mask_avx2(std::span<const raw_t> values, raw_t threshold, std::uint8_t *mask) noexcept {
+            const auto t = _mm256_set1_epi64x(threshold);
+            size_t count = 0;
+            size_t i = 0;
+            for (; i + 4 <= values.size(); i += 4){
+                const auto gt = _mm256_cmpgt_epi64(load4(values.data() + i), t);
+                const auto bits = static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(gt)));
+                for (unsigned lane = 0; lane < 4; ++lane)
+                    mask[i + lane] = (bits >> lane) & 1;
+                count += std::popcount(bits);
+            }
+            return count + greater_mask_scalar(values.subspan(i), threshold, mask + i);
+        }
+
+        SIMD_TARGET("sse4.2")
+        inline size_t greater_mask_sse(std::span<const raw_t> values, raw_t threshold, std::uint8_t *mask) noexcept {
+            const auto t = _mm_set1_epi64x(threshold);
+            size_t count = 0;
+            size_t i = 0;
+            for (; i + 2 <= values.size(); i += 2){
+                const auto gt = _mm_cmpgt_epi64(load2(values.data() + i), t);
+                const auto bits = static_cast<unsigned>(_mm_movemask_pd(_mm_castsi128_pd(gt)));
+                mask[i] = bits & 1;
+                mask[i + 1] = bits >> 1;
+                count += std::popcount(bits);
+            }
+            return count + greater_mask_scalar(values.subspan(i), threshold, mask + i);
+        }
+
+        // Stores the whole permuted vector: the write never passes values.size(),
+        // because at most i elements were selected before position i
+        SIMD_TARGET("avx2")
+        inline size_t copy_greater_avx2(std::span<const raw_t> values, raw_t threshold, raw_t *out) noexcept {
+            const auto t = _mm256_set1_epi64x(threshold);
+            size_t count = 0;
+            size_t i = 0;
+            for (; i + 4 <= values.size(); i += 4){
+                const auto v = load4(values.data() + i);
+                const auto gt = _mm256_cmpgt_epi64(v, t);
+                const auto bits = static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(gt)));
+                const auto permutation = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i*>(compress_table[bits].data()));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + count),
+                                    _mm256_permutevar8x32_epi32(v, permutation));
+                count += std::popcount(bits);
+            }
+            return count + copy_greater_scalar(values.subspan(i), threshold, out + count);
+        }
+
+        SIMD_TARGET("sse4.2")
+        inline size_t copy_greater_sse(std::span<const raw_t> values, raw_t threshold, raw_t *out) noexcept {
+            const auto t = _mm_set1_epi64x(threshold);
+            size_t count = 0;
+            size_t i = 0;
+            for (; i + 2 <= values.size(); i += 2){
+                const auto v = load2(values.data() + i);
+                const auto bits = static_cast<unsigned>(_mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(v, t))));
+                // Only the upper lane selected: move it down
+                const auto packed = bits == 2 ? _mm_unpackhi_epi64(v, v) : v;
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + count), packed);
+                count += std::popcount(bits);
+            }
+            return count + copy_greater_scalar(values.subspan(i), threshold, out + count);
+        }
+#endif
+
+        inline raw_t sum(std::span<const raw_t> values) noexcept {
+#if HAS_X86_SIMD
+            switch (level()){
+                case simd_level::avx2: return sum_avx2(values);
+                case simd_level::sse4_2: return sum_sse(values);
+                default: break;
+            }
+#endif
+            return sum_scalar(values);
+        }
+
+        template<bool take_min>
+        inline raw_t extreme(std::span<const raw_t> values) {
+            if (values.empty())
+                throw std::runtime_error("Can't find minimum or maximum of an empty range");
+#if HAS_X86_SIMD
+            switch (level()){
+                case simd_level::avx2: return extreme_avx2<take_min>(values, values.front());
+                case simd_level::sse4_2: return extreme_sse<take_min>(values, values.front());
+                default: break;
+            }
+#endif
+            return extreme_scalar<take_min>(values, values.front());
+        }
+
+        inline size_t greater_mask(std::span<const raw_t> values, raw_t threshold, std::uint8_t *mask) noexcept {
+#if HAS_X86_SIMD
+            switch (level()){
+                case simd_level::avx2: return greater_mask_avx2(values, threshold, mask);
+                case simd_level::sse4_2: return greater_mask_sse(values, threshold, mask);
+                default: break;
+            }
+#endif
+            return greater_mask_scalar(values, threshold, mask);
+        }
+
+        inline size_t copy_greater(std::span<const raw_t> values, raw_t threshold, raw_t *out) noexcept {
+#if HAS_X86_SIMD
+            switch (level()){
+                case simd_level::avx2: return copy_greater_avx2(values, threshold, out);
+                case simd_level::sse4_2: return copy_greater_sse(values, threshold, out);
+                default: break;
+            }
+#endif
+            return copy_greater_scalar(values, threshold, out);
+        }
+    }
+
+    // Sum of all values. Like number::operator+, it doesn't check for overflow.
+    template<NumberRange range_t>
+    auto sum(const range_t &values) noexcept {
+        using number_t = detail::number_of<range_t>;
+        return number_t::from_raw(detail::sum(detail::raw_span(values)));
+    }
+
+    template<NumberRange range_t>
+    auto mean(const range_t &values) {
+        using number_t = detail::number_of<range_t>;
+        const auto raw = detail::raw_span(values);
+        if (raw.empty())
+            throw std::runtime_error("Can't calculate mean of an empty range");
+        return number_t::from_raw(detail::round_div(detail::sum(raw), static_cast<detail::raw_t>(raw.size())));
+    }
+
+    // Products are accumulated in 128 bits and rounded back to precision once, at the end
+    template<NumberRange range_t, NumberRange other_range_t>
+    requires std::is_same<detail::number_of<range_t>, detail::number_of<other_range_t>>::value
+    auto dot(const range_t &a, const other_range_t &b) {
+        using number_t = detail::number_of<range_t>;
+        const auto raw_a = detail::raw_span(a);
+        const auto raw_b = detail::raw_span(b);
+        if (raw_a.size() != raw_b.size())
+            throw std::runtime_error("Dot product requires ranges of the same size");
+        return number_t::from_raw(detail::round_div(detail::dot_scalar(raw_a, raw_b), number_t::offset));
+    }
+
+    template<NumberRange range_t>
+    auto min(const range_t &values) {
+        using number_t = detail::number_of<range_t>;
+        return number_t::from_raw(detail::extreme<true>(detail::raw_span(values)));
+    }
+
+    template<NumberRange range_t>
+    auto max(const range_t &values) {
+        using number_t = detail::number_of<range_t>;
+        return number_t::from_raw(detail::extreme<false>(detail::raw_span(values)));
+    }
+
+    // Sets mask[i] to 1 if values[i] > threshold, 0 otherwise. Returns the number of ones.
+    template<NumberRange range_t>
+    size_t greater_mask(const range_t &values, const detail::number_of<range_t> &threshold, std::span<std::uint8_t> mask) {
+        const auto raw = detail::raw_span(values);
+        if (mask.size() < raw.size())
+            throw std::runtime_error("Mask is smaller than the input range");
+        return detail::greater_mask(raw, threshold.raw(), mask.data());
+    }
+
+    // Copies values > threshold to the front of out, preserving order. Returns how many were copied.
+    // out must be at least as large as values: elements past the returned count are overwritten.
+    template<NumberRange range_t, NumberRange out_range_t>
+    requires std::is_same<detail::number_of<range_t>, detail::number_of<out_range_t>>::value
+    size_t copy_greater(const range_t &values, const detail::number_of<range_t> &threshold, out_range_t &&out) {
+        const auto raw = detail::raw_span(values);
+        const auto raw_out = detail::raw_span(out);
+        if (raw_out.size() < raw.size())
+            throw std::runtime_error("Output range is smaller than the input range");
+        return detail::copy_greater(raw, threshold.raw(), raw_out.data());
+    }
+
+    template<NumberRange range_t>
+    auto filter_greater(const range_t &values, const detail::number_of<range_t> &threshold) {
+        std::vector<detail::number_of<range_t>> result(std::ranges::size(values));
+        result.resize(copy_greater(values, threshold, result));
+        return result;
+    }
+
+    // Converts every element to another precision, rounding half away from zero.
+    // Like the number constructor, values too large for the higher precision saturate.
+    // Scaling by a constant power of ten is left to the compiler's auto-vectoriser.
+    template<unsigned short to_precision_v, NumberRange range_t, NumberRange out_range_t>
+    requires std::is_same<number<to_precision_v>, detail::number_of<out_range_t>>::value
+    void rescale(const range_t &values, out_range_t &&out) {
+        constexpr auto from_precision = detail::number_of<range_t>::precision;
+        const auto raw = detail::raw_span(values);
+        const auto raw_out = detail::raw_span(out);
+        if (raw_out.size() < raw.size())
+            throw std::runtime_error("Output range is smaller than the input range");
+        for (size_t i = 0; i < raw.size(); ++i)
+            raw_out[i] = rescale_raw<to_precision_v, from_precision>(raw[i]);
+    }
+}
@@ -1,9 +1,12 @@
 #include "ctasks.h"
+#include "online_statistics.h"
+#include "price_series.h"
 
+#include <algorithm>
 #include <chrono>
-#include <cmath>
 #include <iostream>
 #include <memory>
+#include <string_view>
 #include <vector>
 
 using namespace std::chrono_literals; using namespace std;
@@ -29,61 +32,76 @@ ctask<int> mul_add(int a, int b, int c, int d){
 }
 
 template<typename iterator_t>
-ctask<std::vector<double>> find_above_average(iterator_t from, iterator_t to, double average){
+ctask<std::vector<double>> find_above_average(iterator_t from, iterator_t to, double average,
+                                              std::chrono::milliseconds work_per_price){
     co_await "ChunkAboveAverage";
-    using namespace std::chrono_literals;
     std::vector<double> above_average;
     std::copy_if(from, to,
         std::back_inserter(above_average),
-            [average](auto price){
-                std::this_thread::sleep_for(2s);
+            [average, work_per_price](auto price){
+                // Simulates expensive work per price
+                if (work_per_price.count() != 0)
+                    std::this_thread::sleep_for(work_per_price);
                 return price > average;
             });
 
     co_return above_average;
 }
 
-ctask<int> fork_join_example(){
+// How far ahead of its scan position a task reads a mapped column
+constexpr size_t read_ahead_size = (4 << 20) / sizeof(double);
+
+// The first pass over a mapped column faults its pages in. All chunks run at once,
+// so each task reads ahead within its own chunk, one window in front of its scan.
+ctask<online_statistics<double>> chunk_statistics(std::span<const double> chunk){
+    co_await "ChunkStatistics";
+    online_statistics<double> statistics;
+    for (auto rest = chunk; !rest.empty();){
+        const auto window = rest.first(std::min(rest.size(), read_ahead_size));
+        rest = rest.subspan(window.size());
+        price_series::will_need(rest.first(std::min(rest.size(), read_ahead_size)));
+        for (auto price: window)
+            statistics.add(price);
+    }
+    co_return statistics;
+}
+
+// daily_price can be a mapped price_series column: chunks are spans into it, nothing is copied
+ctask<int> fork_join_example(std::span<const double> daily_price, std::chrono::milliseconds work_per_price){
     co_await "Root";
-    vector<double> daily_price = { 100.3, 101.5, 99.2, 105.1, 101.93,
-                                   96.7, 97.6, 103.9, 105.8, 101.2};
-    auto average = co_await [&daily_price]() -> ctask<double> {
-        co_await "Average";
-        auto average = 0.0;
-        for (auto p: daily_price)
-            average += p;
-        average /= daily_price.size();
-        co_return average;
-    }();
+    // A single parallel pass gives all statistics: each chunk is summarised
+    // separately and the summaries are merged
+    auto statistics = co_await [daily_price]() -> ctask<online_statistics<double>> {
+        co_await "Statistics";
+        const auto nof_chunks = 4; // parallelism level
 
-    auto stddev_task = [&daily_price](double average) -> ctask<double>{
-        co_await "StdDev";
-        auto sum_squares = 0.0;
-        for (auto price: daily_price){
-            auto distance = price - average;
-            sum_squares += distance * distance;
-        }
-        co_return sqrt(sum_squares / (daily_price.size() - 1));
-    } (average);
+        const auto chunks = split_aligned(daily_price, nof_chunks);
+        vector<ctask<online_statistics<double>>> tasks;
+        for (auto chunk: chunks)
+            tasks.push_back(chunk_statistics(chunk));
 
-    auto above_average_task = [&daily_price](double average) -> ctask<vector<double>> {
+        online_statistics<double> result;
+        for (auto &t: tasks)
+            result.merge(co_await t);
+        co_return result;
+    }();
+    auto average = statistics.mean();
+
+    // Everything is passed as parameters, which are copied into the coroutine frame:
+    // captures would live in the closure, a temporary gone before the coroutine runs
+    auto above_average_task = [](std::span<const double> daily_price, double average,
+                                 std::chrono::milliseconds work_per_price) -> ctask<vector<double>> {
         co_await "AboveAverage";
         vector<double> above_average;
         const auto nof_chunks = 4; // parallelism level
-        const auto chunk_size = daily_price.size() / nof_chunks;
 
         auto start = chrono::steady_clock::now();
 
-        auto from = daily_price.begin();
-        auto to = from + chunk_size;
+        const auto chunks = split_aligned(daily_price, nof_chunks);
         vector<ctask<vector<double>>> tasks;
-        for (auto i = 0; i < nof_chunks; ++i){
-            if (i == nof_chunks - 1)
-                to = daily_price.end();
-            tasks.push_back(find_above_average(from, to, average));
-            from = to;
-            to += chunk_size;
-        }
+        // The statistics pass already faulted every page in
+        for (auto chunk: chunks)
+            tasks.push_back(find_above_average(chunk.begin(), chunk.end(), average, work_per_price));
 
         for (auto &t: tasks){
             auto task_result = co_await t;
@@ -95,13 +113,30 @@ ctask<int> fork_join_example(){
                  << endl;
 
         co_return above_average;
-    }(average);
+    }(daily_price, average, work_per_price);
 
-    cout << "Standard deviation: " << co_await stddev_task << endl;
+    cout << "Standard deviation: " << statistics.stddev() << endl;
     cout << "Elements above average: " << (co_await above_average_task).size() << endl;
     co_return 0;
 }
 
+// Usage: example [price_series_file [column]]
+//        example --convert csv_file price_series_file
 int main(int argc, char *argv[]) {
-    return fork_join_example().get();
+    if (argc == 4 && std::string_view{argv[1]} == "--convert"){
+        convert_csv_to_columnar(argv[2], argv[3]);
+        return 0;
+    }
+
+    set_task_tracing(true);
+    if (argc > 1){
+        // Real histories are far too long for the simulated work
+        price_series prices{argv[1]};
+        auto column = argc > 2 ? prices.column(argv[2]) : prices.column(size_t{0});
+        return fork_join_example(column, 0ms).get();
+    }
+
+    vector<double> daily_price = { 100.3, 101.5, 99.2, 105.1, 101.93,
+                                   96.7, 97.6, 103.9, 105.8, 101.2};
+    return fork_join_example(daily_price, 2s).get();
 }
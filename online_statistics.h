@@ -0,0 +1,249 @@
+#pragma once
+
+#include "constexpr_approx.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <ranges>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Quantile policy for online_statistics that keeps nothing
+struct no_quantiles {
+    void add(double) noexcept {}
+    void merge(const no_quantiles&) noexcept {}
+};
+
+// Mergeable quantile sketch with relative accuracy (DDSketch).
+// Values fall into logarithmic buckets [gamma^(i-1), gamma^i), so any quantile
+// is within relative_accuracy of a value from the input, and merging two
+// sketches just adds their bucket counts.
+// Run time only, so it uses the standard library's log and exp: one log per value added.
+class quantile_sketch {
+    public:
+    explicit quantile_sketch(double relative_accuracy = 0.01)
+        : relative_accuracy_{relative_accuracy}
+        , gamma_{(1 + relative_accuracy) / (1 - relative_accuracy)}
+        , inverse_log_gamma_{1 / std::log(gamma_)}
+    {
+        if (relative_accuracy <= 0 || relative_accuracy >= 1)
+            throw std::runtime_error("Relative accuracy must be between 0 and 1");
+    }
+
+    // Infinity and NaN have no bucket, so they throw
+    void add(double value){
+        if (!std::isfinite(value))
+            throw std::runtime_error("Can't add a non-finite value to a quantile sketch");
+        if (value > 0)
+            positive_.add(bucket_index(value));
+        else if (value < 0)
+            negative_.add(bucket_index(-value));
+        else
+            ++zeros_;
+    }
+
+    void merge(const quantile_sketch &other){
+        if (other.gamma_ != gamma_)
+            throw std::runtime_error("Can't merge sketches with different accuracy");
+        positive_.merge(other.positive_);
+        negative_.merge(other.negative_);
+        zeros_ += other.zeros_;
+    }
+
+    std::uint64_t count() const noexcept {
+        return positive_.total() + negative_.total() + zeros_;
+    }
+
+    double relative_accuracy() const noexcept {
+        return relative_accuracy_;
+    }
+
+    // q in [0, 1], e.g. 0.5 for the median
+    double quantile(double q) const {
+        if (count() == 0)
+            throw std::runtime_error("Can't calculate quantiles of an empty sketch");
+        const auto rank = static_cast<std::uint64_t>(std::clamp(q, 0.0, 1.0) * (count() - 1));
+
+        // Ascending order: negative buckets from the largest magnitude down, zeros, positive buckets up
+        auto seen = std::uint64_t{0};
+        for (auto i = negative_.counts.size(); i-- > 0;){
+            seen += negative_.counts[i];
+            if (seen > rank)
+                return -bucket_value(negative_.offset + static_cast<int>(i));
+        }
+        seen += zeros_;
+        if (seen > rank)
+            return 0;
+        for (size_t i = 0; i < positive_.counts.size(); ++i){
+            seen += positive_.counts[i];
+            if (seen > rank)
+                return bucket_value(positive_.offset + static_cast<int>(i));
+        }
+        return bucket_value(positive_.offset + static_cast<int>(positive_.counts.size()) - 1);
+    }
+
+    private:
+    // Counts of consecutive bucket indices, starting at offset
+    struct bucket_store {
+        int offset = 0;
+        std::vector<std::uint64_t> counts;
+
+        void add(int index, std::uint64_t count = 1){
+            if (counts.empty()){
+                offset = index;
+                counts.push_back(0);
+            }
+            else if (index < offset){
+                counts.insert(counts.begin(), offset - index, 0);
+                offset = index;
+            }
+            else if (index >= offset + static_cast<int>(counts.size())){
+                counts.resize(index - offset + 1, 0);
+            }
+            counts[index - offset] += count;
+        }
+
+        void merge(const bucket_store &other){
+            for (size_t i = 0; i < other.counts.size(); ++i)
+                if (other.counts[i] != 0)
+                    add(other.offset + static_cast<int>(i), other.counts[i]);
+        }
+
+        std::uint64_t total() const noexcept {
+            std::uint64_t sum = 0;
+            for (auto c: counts)
+                sum += c;
+            return sum;
+        }
+    };
+
+    int bucket_index(double magnitude) const {
+        const auto index = std::log(magnitude) * inverse_log_gamma_;
+        return static_cast<int>(std::floor(index)) + 1;
+    }
+
+    // Midpoint (in relative terms) of [gamma^(i-1), gamma^i)
+    double bucket_value(int index) const {
+        return 2 * std::exp(index / inverse_log_gamma_) / (gamma_ + 1);
+    }
+
+    double relative_accuracy_;
+    double gamma_;
+    double inverse_log_gamma_;
+    bucket_store positive_;
+    bucket_store negative_;
+    std::uint64_t zeros_ = 0;
+};
+
+// Count, mean, variance, min and max in one pass (Welford).
+// Statistics of separate chunks can be computed in parallel and merged (Chan et al.).
+// number_t only needs to be comparable and explicitly convertible to double,
+// so both double and fp_math::number work. Mean and variance are always double.
+template<typename number_t, typename quantiles_t = no_quantiles>
+class online_statistics {
+    public:
+    online_statistics() = default;
+
+    explicit online_statistics(quantiles_t quantiles)
+        : quantiles_{std::move(quantiles)}
+        {}
+
+    template<std::ranges::input_range range_t>
+    requires std::is_convertible<std::ranges::range_reference_t<range_t>, const number_t&>::value
+    explicit online_statistics(const range_t &values, quantiles_t quantiles = quantiles_t{})
+        : quantiles_{std::move(quantiles)}
+    {
+        for (const auto &value: values)
+            add(value);
+    }
+
+    void add(const number_t &value){
+        // Quantiles first, so a value they reject leaves the statistics unchanged
+        const auto x = static_cast<double>(value);
+        quantiles_.add(x);
+
+        if (count_ == 0){
+            min_ = value;
+            max_ = value;
+        }
+        else {
+            min_ = value < min_ ? value : min_;
+            max_ = value > max_ ? value : max_;
+        }
+
+        ++count_;
+        const auto delta = x - mean_;
+        mean_ += delta / count_;
+        m2_ += delta * (x - mean_);
+    }
+
+    void merge(const online_statistics &other){
+        if (other.count_ == 0)
+            return;
+        if (count_ == 0){
+            *this = other;
+            return;
+        }
+
+        const auto count = count_ + other.count_;
+        const auto delta = other.mean_ - mean_;
+        mean_ += delta * other.count_ / count;
+        m2_ += other.m2_ + delta * delta * (static_cast<double>(count_) * other.count_ / count);
+        count_ = count;
+        min_ = other.min_ < min_ ? other.min_ : min_;
+        max_ = other.max_ > max_ ? other.max_ : max_;
+        quantiles_.merge(other.quantiles_);
+    }
+
+    size_t count() const noexcept {
+        return count_;
+    }
+
+    double mean() const noexcept {
+        return mean_;
+    }
+
+    // Sample variance, divided by count - 1
+    double variance() const noexcept {
+        return count_ > 1 ? m2_ / (count_ - 1) : 0;
+    }
+
+    double population_variance() const noexcept {
+        return count_ > 0 ? m2_ / count_ : 0;
+    }
+
+    double stddev() const noexcept {
+        return constexpr_math::approx::sqrt(variance());
+    }
+
+    const number_t &min() const {
+        if (count_ == 0)
+            throw std::runtime_error("No values added yet");
+        return min_;
+    }
+
+    const number_t &max() const {
+        if (count_ == 0)
+            throw std::runtime_error("No values added yet");
+        return max_;
+    }
+
+    double quantile(double q) const requires (!std::is_same<quantiles_t, no_quantiles>::value) {
+        return quantiles_.quantile(q);
+    }
+
+    const quantiles_t &quantiles() const noexcept {
+        return quantiles_;
+    }
+
+    private:
+    size_t count_ = 0;
+    double mean_ = 0;
+    double m2_ = 0; // sum of squared distances from the mean
+    number_t min_{};
+    number_t max_{};
+    quantiles_t quantiles_;
+};
@@ -0,0 +1,137 @@
+#include "fp_math.h"
+#include "online_statistics.h"
+#include "test_check.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+    bool close(double a, double b, double relative = 1e-12){
+        return std::abs(a - b) <= relative * std::max({std::abs(a), std::abs(b), 1.0});
+    }
+
+    // Deterministic values in [-range, range), with repeats
+    std::vector<double> make_values(size_t count, double range){
+        std::vector<double> values;
+        std::uint64_t state = 42;
+        for (size_t i = 0; i < count; ++i){
+            state = state * 6364136223846793005 + 1442695040888963407;
+            values.push_back(static_cast<double>(state >> 11) / (1ull << 53) * 2 * range - range);
+        }
+        return values;
+    }
+
+    void known_values(){
+        const std::vector<double> values{2, 4, 4, 4, 5, 5, 7, 9};
+        const online_statistics<double> statistics{values};
+        check(statistics.count() == 8, "count");
+        check(close(statistics.mean(), 5), "mean");
+        check(close(statistics.population_variance(), 4), "population variance");
+        check(close(statistics.variance(), 32.0 / 7), "sample variance");
+        check(close(statistics.stddev(), std::sqrt(32.0 / 7)), "stddev");
+        check(statistics.min() == 2 && statistics.max() == 9, "min and max");
+
+        const online_statistics<double> empty;
+        check(empty.count() == 0 && empty.variance() == 0, "empty statistics");
+        check(throws<std::runtime_error>([&]{ empty.min(); }), "min of empty statistics throws");
+    }
+
+    void merge_matches_single_pass(){
+        const auto values = make_values(1000, 1000);
+        const online_statistics<double> single{values};
+
+        // Uneven parts, including an empty one
+        const std::span<const double> all{values};
+        online_statistics<double> merged;
+        for (auto [from, to]: {std::pair<size_t, size_t>{0, 0}, {0, 1}, {1, 300}, {300, 300}, {300, 1000}})
+            merged.merge(online_statistics<double>{all.subspan(from, to - from)});
+
+        check(merged.count() == single.count(), "merged count");
+        check(close(merged.mean(), single.mean()), "merged mean");
+        check(close(merged.variance(), single.variance()), "merged variance");
+        check(merged.min() == single.min() && merged.max() == single.max(), "merged min and max");
+
+        auto into_empty = online_statistics<double>{};
+        into_empty.merge(single);
+        check(into_empty.count() == single.count() && into_empty.mean() == single.mean(), "merge into empty");
+    }
+
+    void fixed_point_values(){
+        using n4 = fp_math::number<4>;
+        const std::vector<n4> values{n4{1.5}, n4{-2.25}, n4{3.0}};
+        const online_statistics<n4> statistics{values};
+        check(close(statistics.mean(), 2.25 / 3), "fp_math mean");
+        check(statistics.min() == n4{-2.25} && statistics.max() == n4{3.0}, "fp_math min and max");
+    }
+
+    // Exact quantile with the sketch's rank convention
+    double exact_quantile(const std::vector<double> &sorted, double q){
+        return sorted[static_cast<size_t>(q * (sorted.size() - 1))];
+    }
+
+    void quantiles_within_accuracy(){
+        // Negative, zero and positive values, over several orders of magnitude
+        auto values = make_values(20000, 1);
+        for (auto &v: values)
+            v = v * std::abs(v) * 1e6;
+        values.insert(values.end(), 500, 0.0);
+        std::vector<double> sorted = values;
+        std::sort(sorted.begin(), sorted.end());
+
+        constexpr auto accuracy = 0.01;
+        const online_statistics<double, quantile_sketch> statistics{values, quantile_sketch{accuracy}};
+        auto previous = -INFINITY;
+        for (auto q = 0.0; q <= 1.0; q += 0.005){
+            const auto exact = exact_quantile(sorted, q);
+            const auto estimate = statistics.quantile(q);
+            check(std::abs(estimate - exact) <= accuracy * std::abs(exact) * (1 + 1e-9), "quantile within accuracy");
+            check(estimate >= previous, "quantiles in ascending order");
+            previous = estimate;
+        }
+        check(statistics.quantile(0) < 0 && statistics.quantile(1) > 0, "negative and positive ends");
+        const auto zeros_from = static_cast<double>(std::lower_bound(sorted.begin(), sorted.end(), 0.0) - sorted.begin());
+        check(statistics.quantile((zeros_from + 250) / (sorted.size() - 1)) == 0, "zeros between negatives and positives");
+    }
+
+    void non_finite_values_rejected(){
+        online_statistics<double, quantile_sketch> statistics;
+        statistics.add(1.0);
+        for (auto value: {INFINITY, -INFINITY, NAN})
+            check(throws<std::runtime_error>([&]{ statistics.add(value); }), "non-finite value throws");
+        statistics.add(3.0);
+        check(statistics.count() == 2 && statistics.mean() == 2 && statistics.max() == 3, "rejected values not counted");
+        check(statistics.quantiles().count() == 2, "rejected values not in the sketch");
+    }
+
+    void merged_sketches_match_single_sketch(){
+        const auto values = make_values(5000, 100);
+        const online_statistics<double, quantile_sketch> single{values};
+
+        const std::span<const double> all{values};
+        online_statistics<double, quantile_sketch> merged{all.first(1234)};
+        merged.merge(online_statistics<double, quantile_sketch>{all.subspan(1234)});
+
+        check(merged.quantiles().count() == single.quantiles().count(), "merged sketch count");
+        auto same = true;
+        for (auto q = 0.0; q <= 1.0; q += 0.01)
+            same = same && merged.quantile(q) == single.quantile(q);
+        check(same, "merged sketch quantiles");
+
+        check(throws<std::runtime_error>([&]{ quantile_sketch{0.01}.merge(quantile_sketch{0.02}); }), "merging different accuracies throws");
+    }
+}
+
+int main(){
+    known_values();
+    merge_matches_single_pass();
+    fixed_point_values();
+    quantiles_within_accuracy();
+    non_finite_values_rejected();
+    merged_sketches_match_single_sketch();
+
+    return test_exit_code();
+}
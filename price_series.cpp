@@ -0,0 +1,346 @@
+#include "price_series.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    // Layout unit of the file format. Independent of the OS page size,
+    // which can be larger (e.g. 16k) and is only used for madvise.
+    constexpr size_t format_page_size = 4096;
+    constexpr size_t cache_line_size = 64;
+    constexpr char file_magic[8] = {'P', 'X', 'C', 'O', 'L', 'v', '1', '\0'};
+
+    [[noreturn]] void throw_errno(const std::string &what){
+        throw std::system_error(errno, std::generic_category(), what);
+    }
+
+    size_t round_up(size_t value, size_t alignment){
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    size_t os_page_size(){
+        static const auto size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        return size;
+    }
+
+    class file_descriptor {
+        public:
+        file_descriptor(const std::string &path, int flags, mode_t mode = 0)
+            : fd_{open(path.c_str(), flags, mode)}
+        {
+            if (fd_ < 0)
+                throw_errno("Can't open " + path);
+        }
+
+        ~file_descriptor(){
+            close(fd_);
+        }
+
+        file_descriptor(const file_descriptor&) = delete;
+        file_descriptor &operator =(const file_descriptor&) = delete;
+
+        int get() const noexcept {
+            return fd_;
+        }
+
+        size_t size() const {
+            struct stat st;
+            if (fstat(fd_, &st) != 0)
+                throw_errno("Can't get file size");
+            return static_cast<size_t>(st.st_size);
+        }
+
+        private:
+        int fd_;
+    };
+
+    class mapping {
+        public:
+        mapping(const file_descriptor &fd, size_t size, bool writable)
+            : size_{size}
+        {
+            data_ = mmap(nullptr, size, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                         writable ? MAP_SHARED : MAP_PRIVATE, fd.get(), 0);
+            if (data_ == MAP_FAILED)
+                throw_errno("Can't map file");
+        }
+
+        ~mapping(){
+            if (data_)
+                munmap(data_, size_);
+        }
+
+        mapping(const mapping&) = delete;
+        mapping &operator =(const mapping&) = delete;
+
+        void *data() const noexcept {
+            return data_;
+        }
+
+        // Ownership moves to the caller
+        void *release() noexcept {
+            return std::exchange(data_, nullptr);
+        }
+
+        private:
+        void *data_;
+        size_t size_;
+    };
+
+    std::string_view trim(std::string_view s){
+        while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+            s.remove_prefix(1);
+        while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r'))
+            s.remove_suffix(1);
+        return s;
+    }
+
+    // Reuses fields' storage, so that rows don't allocate
+    void split_fields(std::string_view line, std::vector<std::string_view> &fields){
+        fields.clear();
+        for (size_t start = 0;;){
+            const auto comma = line.find(',', start);
+            fields.push_back(trim(line.substr(start, comma - start)));
+            if (comma == std::string_view::npos)
+                return;
+            start = comma + 1;
+        }
+    }
+
+    bool parse_double(std::string_view text, double &value){
+        const auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+        return ec == std::errc{} && ptr == text.data() + text.size();
+    }
+
+    // Calls fn for every line that isn't blank
+    template<typename fn_t>
+    void for_each_line(std::string_view text, fn_t &&fn){
+        while (!text.empty()){
+            const auto end = text.find('\n');
+            const auto line = text.substr(0, end);
+            if (!trim(line).empty())
+                fn(line);
+            if (end == std::string_view::npos)
+                break;
+            text.remove_prefix(end + 1);
+        }
+    }
+}
+
+struct price_series::header {
+    static constexpr size_t max_columns = 64;
+
+    struct column_descriptor {
+        char name[48];
+        std::uint64_t offset; // from the start of the file, page aligned
+    };
+
+    char magic[8];
+    std::uint64_t nof_rows;
+    std::uint64_t nof_columns;
+    column_descriptor columns[max_columns];
+};
+
+static_assert(sizeof(price_series::header) <= format_page_size);
+
+std::vector<std::span<const double>> split_aligned(std::span<const double> values, size_t nof_chunks){
+    if (nof_chunks == 0)
+        throw std::runtime_error("Number of chunks must be positive");
+
+    constexpr auto per_cache_line = cache_line_size / sizeof(double);
+    constexpr auto per_page = format_page_size / sizeof(double);
+    const auto chunk_size = values.size() / nof_chunks;
+    const auto alignment = chunk_size >= per_page ? per_page
+                         : chunk_size >= per_cache_line ? per_cache_line
+                         : 1;
+
+    // Boundaries are aligned in memory, not relative to values.data():
+    // the first aligned element is at index lead
+    const auto address = reinterpret_cast<std::uintptr_t>(values.data()) / sizeof(double);
+    const auto lead = static_cast<std::ptrdiff_t>((alignment - address % alignment) % alignment);
+    const auto step = static_cast<std::ptrdiff_t>(alignment);
+    const auto size = static_cast<std::ptrdiff_t>(values.size());
+
+    auto boundary = [&](size_t i) -> size_t {
+        if (i == 0)
+            return 0;
+        if (i == nof_chunks)
+            return values.size();
+        const auto ideal = static_cast<std::ptrdiff_t>(i * values.size() / nof_chunks);
+        const auto from_lead = ideal - lead + step / 2;
+        // Rounds down, also for negative values
+        const auto aligned = lead + (from_lead >= 0 ? from_lead / step : (from_lead - step + 1) / step) * step;
+        return static_cast<size_t>(std::clamp<std::ptrdiff_t>(aligned, 0, size));
+    };
+
+    std::vector<std::span<const double>> chunks;
+    chunks.reserve(nof_chunks);
+    for (size_t i = 0; i < nof_chunks; ++i){
+        const auto from = boundary(i);
+        chunks.push_back(values.subspan(from, boundary(i + 1) - from));
+    }
+    return chunks;
+}
+
+price_series::price_series(const std::string &path){
+    file_descriptor fd{path, O_RDONLY};
+    const auto size = fd.size();
+    if (size < format_page_size)
+        throw std::runtime_error("Not a price series file: " + path);
+
+    mapping map{fd, size, false};
+    const auto &h = *static_cast<const header*>(map.data());
+    if (std::memcmp(h.magic, file_magic, sizeof(file_magic)) != 0 || h.nof_columns > header::max_columns)
+        throw std::runtime_error("Not a price series file: " + path);
+    for (size_t i = 0; i < h.nof_columns; ++i){
+        const auto &column = h.columns[i];
+        if (!std::memchr(column.name, '\0', sizeof(column.name)) ||
+            column.offset % format_page_size != 0 ||
+            column.offset > size || h.nof_rows > (size - column.offset) / sizeof(double))
+            throw std::runtime_error("Corrupt price series file: " + path);
+    }
+
+    // Only a hint: more aggressive read-ahead, and pages can be dropped soon after use
+    madvise(map.data(), size, MADV_SEQUENTIAL);
+
+    data_ = map.release();
+    size_ = size;
+}
+
+price_series::~price_series(){
+    if (data_)
+        munmap(data_, size_);
+}
+
+price_series::price_series(price_series &&other) noexcept
+    : data_{std::exchange(other.data_, nullptr)}
+    , size_{std::exchange(other.size_, 0)}
+    {}
+
+price_series &price_series::operator =(price_series &&other) noexcept {
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+    return *this;
+}
+
+const price_series::header &price_series::get_header() const noexcept {
+    return *static_cast<const header*>(data_);
+}
+
+size_t price_series::size() const noexcept {
+    return get_header().nof_rows;
+}
+
+size_t price_series::nof_columns() const noexcept {
+    return get_header().nof_columns;
+}
+
+std::string_view price_series::column_name(size_t index) const {
+    if (index >= nof_columns())
+        throw std::runtime_error("Column index out of range");
+    return get_header().columns[index].name;
+}
+
+std::span<const double> price_series::column(size_t index) const {
+    if (index >= nof_columns())
+        throw std::runtime_error("Column index out of range");
+    const auto first = static_cast<const std::byte*>(data_) + get_header().columns[index].offset;
+    return {reinterpret_cast<const double*>(first), size()};
+}
+
+std::span<const double> price_series::column(std::string_view name) const {
+    for (size_t i = 0; i < nof_columns(); ++i)
+        if (column_name(i) == name)
+            return column(i);
+    throw std::runtime_error("No column named " + std::string{name});
+}
+
+void price_series::will_need(std::span<const double> values) noexcept {
+    if (values.empty())
+        return;
+    const auto page = os_page_size();
+    const auto first = reinterpret_cast<std::uintptr_t>(values.data()) / page * page;
+    const auto last = reinterpret_cast<std::uintptr_t>(values.data() + values.size());
+    madvise(reinterpret_cast<void*>(first), last - first, MADV_WILLNEED);
+}
+
+void convert_csv_to_columnar(const std::string &csv_path, const std::string &columnar_path){
+    file_descriptor in{csv_path, O_RDONLY};
+    const auto in_size = in.size();
+    if (in_size == 0)
+        throw std::runtime_error("Empty CSV file: " + csv_path);
+    mapping in_map{in, in_size, false};
+    madvise(in_map.data(), in_size, MADV_SEQUENTIAL);
+
+    std::string_view text{static_cast<const char*>(in_map.data()), in_size};
+    const auto header_end = text.find('\n');
+    std::vector<std::string_view> names;
+    split_fields(text.substr(0, header_end), names);
+    text.remove_prefix(header_end == std::string_view::npos ? text.size() : header_end + 1);
+
+    // First pass: count rows and pick the numeric columns from the first row
+    size_t nof_rows = 0;
+    std::vector<size_t> numeric;
+    std::vector<std::string_view> fields;
+    for_each_line(text, [&](std::string_view line){
+        if (nof_rows++ == 0){
+            split_fields(line, fields);
+            for (size_t i = 0; i < std::min(fields.size(), names.size()); ++i){
+                double value;
+                if (parse_double(fields[i], value))
+                    numeric.push_back(i);
+            }
+        }
+    });
+    if (numeric.size() > price_series::header::max_columns)
+        throw std::runtime_error("Too many numeric columns in " + csv_path);
+
+    const auto column_size = round_up(nof_rows * sizeof(double), format_page_size);
+    const auto out_size = format_page_size + numeric.size() * column_size;
+    file_descriptor out{columnar_path, O_RDWR | O_CREAT | O_TRUNC, 0644};
+    try {
+        if (ftruncate(out.get(), static_cast<off_t>(out_size)) != 0)
+            throw_errno("Can't resize " + columnar_path);
+        mapping out_map{out, out_size, true};
+
+        auto &h = *static_cast<price_series::header*>(out_map.data());
+        std::memcpy(h.magic, file_magic, sizeof(file_magic));
+        h.nof_rows = nof_rows;
+        h.nof_columns = numeric.size();
+        std::vector<double*> columns;
+        for (size_t c = 0; c < numeric.size(); ++c){
+            const auto name = names[numeric[c]].substr(0, sizeof(h.columns[c].name) - 1);
+            std::memcpy(h.columns[c].name, name.data(), name.size());
+            h.columns[c].offset = format_page_size + c * column_size;
+            columns.push_back(reinterpret_cast<double*>(
+                static_cast<std::byte*>(out_map.data()) + h.columns[c].offset));
+        }
+
+        // Second pass: parse values straight into the mapped columns
+        size_t row = 0;
+        for_each_line(text, [&](std::string_view line){
+            split_fields(line, fields);
+            for (size_t c = 0; c < numeric.size(); ++c){
+                if (numeric[c] >= fields.size() || !parse_double(fields[numeric[c]], columns[c][row]))
+                    throw std::runtime_error("Invalid value in " + csv_path + ", row " +
+                                             std::to_string(row + 1) + ", column " +
+                                             std::string{names[numeric[c]]});
+            }
+            ++row;
+        });
+    }
+    catch (...) {
+        unlink(columnar_path.c_str());
+        throw;
+    }
+}
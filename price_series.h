@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Splits values into nof_chunks spans of roughly equal size for parallel tasks.
+// Boundaries fall on cache lines, and on pages once chunks are large enough,
+// so that two tasks never share a cache line (or a page of read-ahead).
+// Alignment is by address, so values.data() itself doesn't need to be aligned;
+// the first and last chunks then absorb the unaligned ends.
+std::vector<std::span<const double>> split_aligned(std::span<const double> values, size_t nof_chunks);
+
+// Read-only, memory-mapped price history in a simple binary columnar format:
+// a one-page header with row count and column names, then each column as a
+// page-aligned array of native doubles. Nothing is read until it's touched,
+// so opening a file of any size is instant and columns are handed out as
+// zero-copy spans.
+// OS errors are reported with std::system_error, malformed files with std::runtime_error.
+class price_series {
+    public:
+    explicit price_series(const std::string &path);
+    ~price_series();
+
+    price_series(const price_series&) = delete;
+    price_series &operator =(const price_series&) = delete;
+    price_series(price_series &&other) noexcept;
+    price_series &operator =(price_series &&other) noexcept;
+
+    size_t size() const noexcept;
+    size_t nof_columns() const noexcept;
+    std::string_view column_name(size_t index) const;
+
+    std::span<const double> column(size_t index) const;
+    std::span<const double> column(std::string_view name) const;
+
+    std::vector<std::span<const double>> chunks(std::string_view name, size_t nof_chunks) const {
+        return split_aligned(column(name), nof_chunks);
+    }
+
+    // Starts asynchronous read-ahead of the pages under values,
+    // e.g. for the next window of a chunk while the current one is processed
+    static void will_need(std::span<const double> values) noexcept;
+
+    // On-disk layout, defined in price_series.cpp
+    struct header;
+
+    private:
+    const header &get_header() const noexcept;
+
+    void *data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Converts a CSV file with a header line of column names into the price_series format.
+// Columns whose first value isn't a number (e.g. dates) are skipped.
+// Both files are memory-mapped, so memory use doesn't depend on the file size.
+void convert_csv_to_columnar(const std::string &csv_path, const std::string &columnar_path);
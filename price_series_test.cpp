@@ -0,0 +1,123 @@
+#include "price_series.h"
+#include "test_check.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+namespace {
+    bool is_aligned(const void *p, size_t alignment){
+        return reinterpret_cast<std::uintptr_t>(p) % alignment == 0;
+    }
+
+    // Unique per process, so concurrent test runs don't share files
+    std::filesystem::path temporary_path(const char *extension){
+        return std::filesystem::temp_directory_path() /
+            ("price_series_test_" + std::to_string(getpid()) + extension);
+    }
+
+    // Removes the files when the test ends, also on failure
+    struct temporary_files {
+        std::filesystem::path csv = temporary_path(".csv");
+        std::filesystem::path columnar = temporary_path(".pxcol");
+
+        ~temporary_files(){
+            std::filesystem::remove(csv);
+            std::filesystem::remove(columnar);
+        }
+    };
+
+    double open_price(size_t row){
+        return 100 + static_cast<double>(row % 1000) / 8;
+    }
+
+    double close_price(size_t row){
+        return -1.5 * static_cast<double>(row) + 0.25;
+    }
+
+    void write_csv(const std::filesystem::path &path, size_t nof_rows){
+        std::ofstream out{path};
+        out.precision(17);
+        out << "date, open ,close\r\n";
+        for (size_t row = 0; row < nof_rows; ++row)
+            out << "2024-01-" << row << ',' << open_price(row) << ", " << close_price(row) << "\r\n";
+        out << "\n";
+    }
+
+    void round_trip(){
+        constexpr size_t nof_rows = 100003;
+        temporary_files files;
+        write_csv(files.csv, nof_rows);
+        convert_csv_to_columnar(files.csv, files.columnar);
+
+        const price_series prices{files.columnar};
+        check(prices.size() == nof_rows, "row count");
+        check(prices.nof_columns() == 2, "date column skipped");
+        check(prices.column_name(0) == "open" && prices.column_name(1) == "close", "column names");
+
+        const auto open = prices.column("open");
+        const auto close = prices.column("close");
+        check(is_aligned(open.data(), 4096) && is_aligned(close.data(), 4096), "columns page aligned");
+        auto same = true;
+        for (size_t row = 0; row < nof_rows; ++row)
+            same = same && open[row] == open_price(row) && close[row] == close_price(row);
+        check(same, "values round trip");
+
+        const auto chunks = prices.chunks("close", 4);
+        auto contiguous = chunks.front().data() == close.data() && chunks.back().data() + chunks.back().size() == close.data() + close.size();
+        auto aligned = true;
+        for (size_t i = 1; i < chunks.size(); ++i){
+            contiguous = contiguous && chunks[i - 1].data() + chunks[i - 1].size() == chunks[i].data();
+            aligned = aligned && is_aligned(chunks[i].data(), 4096);
+        }
+        check(contiguous, "chunks cover the column");
+        check(aligned, "chunks page aligned");
+
+        check(throws<std::runtime_error>([&]{ prices.column("volume"); }), "unknown column throws");
+    }
+
+    void invalid_csv(){
+        temporary_files files;
+        {
+            std::ofstream out{files.csv};
+            out << "open,close\n1,2\n3,x\n";
+        }
+        check(throws<std::runtime_error>([&]{ convert_csv_to_columnar(files.csv, files.columnar); }), "invalid value throws");
+        check(!std::filesystem::exists(files.columnar), "no output left after failure");
+
+        check(throws<std::runtime_error>([&]{ price_series prices{files.csv}; }), "CSV isn't a price series file");
+    }
+
+    // Chunks of an unaligned range: boundaries still fall on cache lines
+    void split_unaligned(){
+        std::vector<double> values(10000 + 3);
+        const auto unaligned = std::span<const double>{values}.subspan(3);
+        for (auto nof_chunks: {1, 3, 4, 7, 200, 20000}){
+            const auto chunks = split_aligned(unaligned, nof_chunks);
+            auto contiguous = chunks.size() == static_cast<size_t>(nof_chunks) && chunks.front().data() == unaligned.data();
+            auto aligned = true;
+            for (size_t i = 1; i < chunks.size(); ++i){
+                contiguous = contiguous && chunks[i - 1].data() + chunks[i - 1].size() == chunks[i].data();
+                const auto at_end = chunks[i].data() == unaligned.data() + unaligned.size();
+                const auto at_start = chunks[i].data() == unaligned.data();
+                aligned = aligned && (at_start || at_end || unaligned.size() / nof_chunks < 8 || is_aligned(chunks[i].data(), 64));
+            }
+            contiguous = contiguous && chunks.back().data() + chunks.back().size() == unaligned.data() + unaligned.size();
+            check(contiguous, "unaligned chunks cover the range");
+            check(aligned, "unaligned chunks aligned in memory");
+        }
+    }
+}
+
+int main(){
+    round_trip();
+    invalid_csv();
+    split_unaligned();
+
+    return test_exit_code();
+}
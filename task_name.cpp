@@ -1,12 +1,39 @@
+#include "task_name.h"
+
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
 #include <string>
+#include <unordered_map>
+
+static thread_local task_name_id task_name_;
+static std::atomic<bool> task_tracing_{false};
 
-static thread_local std::string task_name_;
+task_name_id task_name_id::intern(std::string_view name){
+    static std::mutex mutex;
+    // Nodes never move, so views of the stored strings stay valid
+    static std::unordered_map<std::uint64_t, std::string> registry;
+
+    const auto id = hash(name);
+    std::scoped_lock lock{mutex};
+    auto [it, inserted] = registry.try_emplace(id, name);
+    if (!inserted && it->second != name)
+        throw std::runtime_error("Task name " + std::string{name} + " collides with " + it->second);
+    return task_name_id{std::string_view{it->second}};
+}
 
-void set_task_name(const std::string &name){
+void set_task_name(task_name_id name) noexcept {
     task_name_ = name;
 }
 
-const std::string &get_task_name() {
+task_name_id get_task_name() noexcept {
     return task_name_;
 }
 
+void set_task_tracing(bool enabled) noexcept {
+    task_tracing_.store(enabled, std::memory_order_relaxed);
+}
+
+bool task_tracing_enabled() noexcept {
+    return task_tracing_.load(std::memory_order_relaxed);
+}
@@ -1,5 +1,64 @@
 #pragma once
-#include <string>
+#include <cstdint>
+#include <string_view>
 
-void set_task_name(const std::string &name);
-const std::string &get_task_name();
\ No newline at end of file
+// Name of a task, for tracing and profiling.
+// Built from a string literal at compile time, so naming a task never allocates:
+// the id is a hash of the name, and the literal itself is only read when
+// the name is printed. Names built at run time have to be interned once.
+class task_name_id {
+    public:
+    constexpr task_name_id() = default;
+
+    template<size_t size>
+    consteval task_name_id(const char (&literal)[size])
+        : task_name_id{std::string_view{literal, size - 1}}
+        {}
+
+    // Returns the id of a name that isn't a literal, copying it into the registry
+    // the first time it is seen. Locks, so call it once, not per task.
+    static task_name_id intern(std::string_view name);
+
+    constexpr std::uint64_t id() const noexcept {
+        return id_;
+    }
+
+    constexpr std::string_view name() const noexcept {
+        return name_;
+    }
+
+    friend constexpr bool operator ==(const task_name_id &a, const task_name_id &b) noexcept {
+        return a.id_ == b.id_;
+    }
+
+    private:
+    // name must outlive the id: a literal, or a string owned by the registry
+    constexpr explicit task_name_id(std::string_view name)
+        : id_{hash(name)}, name_{name}
+        {}
+
+    // 64-bit FNV-1a
+    static constexpr std::uint64_t hash(std::string_view name) noexcept {
+        std::uint64_t h = 0xcbf29ce484222325;
+        for (auto c: name)
+            h = (h ^ static_cast<unsigned char>(c)) * 0x100000001b3;
+        return h;
+    }
+
+    std::uint64_t id_ = hash({});
+    std::string_view name_;
+};
+
+void set_task_name(task_name_id name) noexcept;
+task_name_id get_task_name() noexcept;
+
+// Task names are only printed while tracing is enabled; it's disabled by default
+void set_task_tracing(bool enabled) noexcept;
+bool task_tracing_enabled() noexcept;
+
+namespace task_name_test {
+    static_assert(task_name_id{"Root"} == task_name_id{"Root"});
+    static_assert(!(task_name_id{"Root"} == task_name_id{"Multiply"}));
+    static_assert(task_name_id{"Root"}.name() == "Root");
+    static_assert(task_name_id{} == task_name_id{""});
+}
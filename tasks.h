@@ -9,7 +9,6 @@
 #include <memory>
 #include <mutex>
 #include <string>
-#include <sstream>
 #include <iostream>
 
 namespace tasks_helpers {
@@ -22,7 +21,7 @@ namespace tasks_helpers {
     inline auto wait_for_tasks(t &&task, tasks_t&& ...tasks){
         return std::tuple_cat(
             wait_for_tasks(std::forward<t>(task)),
-            wait_for_tasks(std::forward<tasks_t...>(tasks...)));
+            wait_for_tasks(std::forward<tasks_t>(tasks)...));
     }
 
     template<typename ...tasks_t>
@@ -93,9 +92,9 @@ class task : public executable {
                  // Unfortunately, one thread in the pool will have to block until
                  // all continuation tasks are finished.
                  // We'll find a way to solve this when we talk about coroutines
-                 std::stringstream s;
-                 s << "Fork/join " << std::tuple_size<decltype(tasks_tuple)>() << " tasks";
-                 set_task_name(s.str());
+                 static const auto name = task_name_id::intern(
+                     "Fork/join " + std::to_string(std::tuple_size<decltype(tasks_tuple)>()) + " tasks");
+                 set_task_name(name);
 
                  // Fork part: schedule the tasks in executor!
                  // Performance issue: there is a delay between this task being finished,
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <iostream>
+
+// Checks for the test executables. A failed check is reported and counted,
+// so one run shows every failure; main returns test_exit_code().
+inline int &nof_test_failures() noexcept {
+    static int nof_failures = 0;
+    return nof_failures;
+}
+
+inline void check(bool condition, const char *what){
+    if (!condition){
+        std::cerr << "FAILED: " << what << std::endl;
+        ++nof_test_failures();
+    }
+}
+
+// True if fn() throws an exception_t
+template<typename exception_t, typename fn_t>
+bool throws(fn_t &&fn){
+    try {
+        fn();
+    }
+    catch (const exception_t&) {
+        return true;
+    }
+    return false;
+}
+
+inline int test_exit_code(){
+    if (nof_test_failures() != 0)
+        std::cerr << nof_test_failures() << " checks failed" << std::endl;
+    return nof_test_failures() == 0 ? 0 : 1;
+}